@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+"""
+roboto_usb2can Build Report
+Summarises flash/RAM usage of zephyr.elf for the selected build profile:
+- RAM broken down into frame buffers, stacks, heap and static tables
+- Burst absorption of the frame buffers at a given bus rate vs USB drain rate
+- Fails (exit code 1) when a flash/RAM budget is exceeded
+Cycles per frame are measured at runtime, read them with:
+    python roboto_usb2can_tool.py --profile-report
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_WRITE = 0x1
+SHF_ALLOC = 0x2
+STT_OBJECT = 1
+
+# RAM categories, first match wins
+RAM_CATEGORIES = (
+    ('stacks', re.compile(r'stack', re.I)),
+    ('heap', re.compile(r'heap', re.I)),
+    ('frame buffers', re.compile(r'net_buf|udc|gs_usb|msgq_buf|_msgq$', re.I)),
+)
+
+# gs_usb host frame: echo_id, can_id, dlc, channel, flags, reserved + data (+ timestamp)
+GS_USB_HEADER_SIZE = 12
+USB_FS_BULK_PACKET = 64
+USB_FS_BULK_PACKETS_PER_MS = 19  # Full-speed bulk maximum per 1 ms frame
+
+# Modelled bus frame: (data bytes, bits per standard ID frame incl. interframe
+# space, without bit stuffing; fd assumes the data phase at the nominal bitrate)
+FRAME_TYPES = {
+    'classic': (8, 111),
+    'fd': (64, 575),
+}
+
+
+def _read_elf(path):
+    """Return the ELF32 image and its raw section headers"""
+    with open(path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1:
+        raise ValueError(f"{path} is not an ELF32 file")
+
+    e_shoff, = struct.unpack_from('<I', elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    headers = [struct.unpack_from('<IIIIIIIIII', elf, e_shoff + i * e_shentsize)
+               for i in range(e_shnum)]
+    return elf, headers, e_shstrndx
+
+
+def _cstr(elf, offset):
+    return elf[offset:elf.index(b'\0', offset)].decode(errors='replace')
+
+
+def read_sections(path):
+    """Return (name, type, flags, size) of all ELF32 sections"""
+    elf, headers, shstrndx = _read_elf(path)
+    strtab_off = headers[shstrndx][4]
+    return [(_cstr(elf, strtab_off + h[0]), h[1], h[2], h[5]) for h in headers]
+
+
+def read_ram_symbols(path):
+    """Return (name, size) of all data objects placed in RAM sections"""
+    elf, headers, _ = _read_elf(path)
+    ram_sections = {i for i, h in enumerate(headers)
+                    if h[2] & SHF_ALLOC and (h[1] == SHT_NOBITS or h[2] & SHF_WRITE)}
+
+    symbols = []
+    for h in headers:
+        if h[1] != SHT_SYMTAB:
+            continue
+        strtab_off = headers[h[6]][4]
+        for offset in range(h[4], h[4] + h[5], h[9]):
+            st_name, _, st_size, st_info, _, st_shndx = struct.unpack_from('<IIIBBH', elf, offset)
+            if st_info & 0xF == STT_OBJECT and st_size and st_shndx in ram_sections:
+                symbols.append((_cstr(elf, strtab_off + st_name), st_size))
+    return symbols
+
+
+def read_config(path):
+    """Parse a Kconfig .config file into a dict"""
+    config = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('CONFIG_') and '=' in line:
+                key, value = line.split('=', 1)
+                config[key] = value.strip('"')
+    return config
+
+
+def memory_usage(sections):
+    """Flash and RAM bytes used by the allocated sections"""
+    flash = ram = 0
+    for _, sh_type, sh_flags, size in sections:
+        if not sh_flags & SHF_ALLOC:
+            continue
+        if sh_type == SHT_NOBITS:
+            ram += size
+        elif sh_flags & SHF_WRITE:
+            # Initialised data: stored in flash, copied to RAM
+            ram += size
+            flash += size
+        else:
+            flash += size
+    return flash, ram
+
+
+def ram_breakdown(symbols, ram):
+    """Split RAM use into categories, plus the largest symbol of each"""
+    totals = {name: 0 for name, _ in RAM_CATEGORIES}
+    totals['static tables'] = 0
+    largest = {}
+    for sym, size in symbols:
+        category = next((name for name, pattern in RAM_CATEGORIES if pattern.search(sym)),
+                        'static tables')
+        totals[category] += size
+        if size > largest.get(category, ('', 0))[1]:
+            largest[category] = (sym, size)
+    # Alignment padding and objects without symbol information
+    totals['unattributed'] = max(ram - sum(totals.values()), 0)
+    return totals, largest
+
+
+def host_frame_size(config, frame_type='classic'):
+    """Bytes of one gs_usb frame of the modelled type on the bulk IN endpoint"""
+    data = FRAME_TYPES[frame_type][0]
+    timestamp = 4 if config.get('CONFIG_USBD_GS_USB_TIMESTAMP') == 'y' else 0
+    return GS_USB_HEADER_SIZE + data + timestamp
+
+
+def burst_capacity(config, frame_type='classic'):
+    """Frames the device can queue for the host, and the limiting knob"""
+    frame_size = host_frame_size(config, frame_type)
+    limits = []
+    if 'CONFIG_USBD_GS_USB_POOL_SIZE' in config:
+        limits.append((int(config['CONFIG_USBD_GS_USB_POOL_SIZE']),
+                       'CONFIG_USBD_GS_USB_POOL_SIZE'))
+    if 'CONFIG_UDC_BUF_COUNT' in config:
+        limits.append((int(config['CONFIG_UDC_BUF_COUNT']), 'CONFIG_UDC_BUF_COUNT'))
+    if 'CONFIG_UDC_BUF_POOL_SIZE' in config:
+        limits.append((int(config['CONFIG_UDC_BUF_POOL_SIZE']) // frame_size,
+                       'CONFIG_UDC_BUF_POOL_SIZE'))
+    return min(limits) if limits else (0, 'unknown')
+
+
+def usb_drain_rate(config, frame_type='classic'):
+    """Full-speed bulk IN upper bound in frames/s"""
+    packets = math.ceil(host_frame_size(config, frame_type) / USB_FS_BULK_PACKET)
+    return USB_FS_BULK_PACKETS_PER_MS * 1000 // packets
+
+
+def burst_report(config, bus_bitrate, frame_bits, drain_rate, frame_type='classic'):
+    capacity, limit = burst_capacity(config, frame_type)
+    frame_bits = frame_bits or FRAME_TYPES[frame_type][1]
+    bus_rate = bus_bitrate / frame_bits
+    drain_rate = drain_rate or usb_drain_rate(config, frame_type)
+
+    lines = [
+        f"Frame queue:    {capacity} {frame_type} frames of "
+        f"{host_frame_size(config, frame_type)} bytes (limited by {limit})",
+        f"Bus rate:       {bus_rate:.0f} frames/s ({bus_bitrate} bit/s, {frame_bits} bits/frame)",
+        f"USB drain rate: {drain_rate:.0f} frames/s",
+    ]
+    if frame_type == 'fd' and config.get('CONFIG_CAN_FD_MODE') != 'y':
+        lines.append("Note:           fd frames modelled but CONFIG_CAN_FD_MODE is not set")
+    if bus_rate > drain_rate:
+        # Queue grows at bus - drain rate until it is full
+        fill_s = capacity / (bus_rate - drain_rate)
+        lines.append(f"Burst absorbed: {bus_rate * fill_s:.0f} frames ({fill_s * 1000:.1f} ms) "
+                     "before RX frames are dropped")
+    else:
+        lines.append("Burst absorbed: unlimited (USB drains faster than the bus delivers)")
+    lines.append(f"Host stall:     {capacity / bus_rate * 1000:.1f} ms without USB reads "
+                 "before RX frames are dropped")
+    return lines
+
+
+def check_budget(name, used, budget):
+    """Return an error line when used exceeds budget (0: no budget)"""
+    if budget and used > budget:
+        return f"ERROR: {name} {used} bytes exceeds budget of {budget} bytes by {used - budget}"
+    return None
+
+
+def profile_report(elf_path, config_path, footprint=False, bus_bitrate=1000000, frame_bits=0,
+                   drain_rate=0, ram_budget=0, flash_budget=0, frame_type='classic'):
+    """Return (report text, budget errors)"""
+    config = read_config(config_path)
+    flash, ram = memory_usage(read_sections(elf_path))
+    flash_total = int(config.get('CONFIG_FLASH_SIZE', '0')) * 1024
+    ram_total = int(config.get('CONFIG_SRAM_SIZE', '0')) * 1024
+
+    def pct(used, total):
+        return f" ({used * 100 / total:.1f}% of {total // 1024} KiB)" if total else ""
+
+    features = ['ROBOTO_ACTIVITY_LED', 'ROBOTO_GATEWAY', 'ROBOTO_HOT_PATH_STATS',
+                'ROBOTO_HOT_PATH_SPEED', 'SPEED_OPTIMIZATIONS', 'SIZE_OPTIMIZATIONS']
+    lines = [
+        f"Build profile:  {config.get('CONFIG_ROBOTO_PROFILE_NAME', 'unknown')}",
+        f"Flash:          {flash} bytes{pct(flash, flash_total)}",
+        f"RAM:            {ram} bytes{pct(ram, ram_total)}",
+        f"gs_usb pool:    {config.get('CONFIG_USBD_GS_USB_POOL_SIZE', '?')} frames",
+        "Features:       " + " ".join(f for f in features if config.get(f'CONFIG_{f}') == 'y'),
+        "Cycles/frame:   " + ("measured at runtime (roboto_usb2can_tool.py --profile-report)"
+                                  if config.get('CONFIG_ROBOTO_HOT_PATH_STATS') == 'y'
+                                  else "not counted (CONFIG_ROBOTO_HOT_PATH_STATS=n)"),
+    ]
+
+    if footprint:
+        totals, largest = ram_breakdown(read_ram_symbols(elf_path), ram)
+        lines.append("RAM breakdown:")
+        for category, size in totals.items():
+            top = f"  largest: {largest[category][0]} ({largest[category][1]})" \
+                if category in largest else ""
+            lines.append(f"  {category:<14} {size:>7} bytes{pct(size, ram_total)}{top}")
+        lines += burst_report(config, bus_bitrate, frame_bits, drain_rate, frame_type)
+
+    # A budget of 0 falls back to the physical memory size
+    errors = [e for e in (check_budget("RAM", ram, ram_budget or ram_total),
+                          check_budget("Flash", flash, flash_budget or flash_total)) if e]
+    return "\n".join(lines + errors) + "\n", errors
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="roboto_usb2can build report")
+    parser.add_argument('--elf', required=True, help="zephyr.elf")
+    parser.add_argument('--config', required=True, help="zephyr/.config")
+    parser.add_argument('--output', help="also write the report to this file")
+    parser.add_argument('--footprint', action='store_true',
+                        help="RAM breakdown and burst absorption")
+    parser.add_argument('--bus-bitrate', type=int, default=1000000,
+                        help="CAN bitrate for the burst calculation (default: 1000000)")
+    parser.add_argument('--frame-type', choices=FRAME_TYPES, default='classic',
+                        help="modelled bus frame, sets host frame size and bits per frame "
+                             "(default: classic, 8 byte standard frame)")
+    parser.add_argument('--frame-bits', type=int, default=0,
+                        help="override bits per frame on the bus (default: from --frame-type, "
+                             "111 classic, 575 fd)")
+    parser.add_argument('--usb-drain-rate', type=float, default=0,
+                        help="host read rate in frames/s (default: full-speed bulk limit)")
+    parser.add_argument('--ram-budget', type=int, default=0,
+                        help="fail when RAM use exceeds this many bytes (default: SRAM size)")
+    parser.add_argument('--flash-budget', type=int, default=0,
+                        help="fail when flash use exceeds this many bytes (default: flash size)")
+    args = parser.parse_args(argv)
+
+    report, errors = profile_report(args.elf, args.config, args.footprint, args.bus_bitrate,
+                                    args.frame_bits, args.usb_drain_rate, args.ram_budget,
+                                    args.flash_budget, args.frame_type)
+    print(report, end='')
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(report)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""
+roboto_usb2can Host Benchmark
+Measures the host tool against the in-process device emulator, no adapter
+needed. Reports frames/s and CPU time per frame for:
+- emulator:  bulk IN reads of the emulator alone (baseline)
+- rx_loop:   RobopartyCAN._rx_loop incl. frame parsing and callback
+- send_frame: RobopartyCAN.send_frame, echoes drained in the background
+- gui:       adapters -> RX threads -> merge -> GUI display, or
+             adapters -> RX threads -> merge when Tk is not available
+"""
+
+import argparse
+import sys
+import threading
+import time
+
+from roboto_usb2can_emulator import GsUsbEmulator
+from roboto_usb2can_merge import MergedCapture
+from roboto_usb2can_tool import BITRATE_1M, RobopartyCAN
+
+PATHS = ('emulator', 'rx_loop', 'send_frame', 'gui')
+
+
+def _emulator(args, rate):
+    return GsUsbEmulator(bus_bitrate=args.bitrate, rx_rate=rate, jitter_us=args.jitter_us,
+                         error_rate=args.error_rate, seed=1)
+
+
+def _open(transport):
+    can = RobopartyCAN(transport)
+    can.open()
+    can.set_bitrate(0, BITRATE_1M)
+    can.start_channel(0)
+    return can
+
+
+def bench_emulator(args):
+    """Baseline: cost of generating and reading frames in the emulator"""
+    emu = _emulator(args, args.rate)
+    can = _open(emu)
+    frames = 0
+    end = time.perf_counter() + args.duration
+    cpu = time.thread_time()
+    while time.perf_counter() < end:
+        try:
+            emu.read(512, timeout=100)
+            frames += 1
+        except Exception:
+            pass
+    cpu = time.thread_time() - cpu
+    can.close()
+    return frames, cpu, emu.stats
+
+
+def bench_rx_loop(args):
+    """RobopartyCAN._rx_loop, run on this thread so its CPU time can be measured"""
+    can = _open(_emulator(args, args.rate))
+    frames = 0
+    end = time.perf_counter() + args.duration
+
+    def callback(frame):
+        nonlocal frames
+        frames += 1
+        if time.perf_counter() >= end:
+            can.rx_running = False
+
+    can.rx_callback = callback
+    can.rx_running = True
+    cpu = time.thread_time()
+    can._rx_loop()
+    cpu = time.thread_time() - cpu
+    stats = can.transport.stats
+    can.close()
+    return frames, cpu, stats
+
+
+def bench_send_frame(args):
+    """RobopartyCAN.send_frame as fast as the emulated bus accepts frames"""
+    emu = _emulator(args, 0)
+    can = _open(emu)
+    running = True
+
+    def drain():
+        while running:
+            try:
+                emu.read(512, timeout=100)
+            except Exception:
+                pass
+
+    drainer = threading.Thread(target=drain, daemon=True)
+    drainer.start()
+
+    frames = 0
+    payload = bytes(range(8))
+    end = time.perf_counter() + args.duration
+    cpu = time.thread_time()
+    while time.perf_counter() < end:
+        can.send_frame(0, 0x123, payload)
+        frames += 1
+    cpu = time.thread_time() - cpu
+
+    running = False
+    drainer.join()
+    can.close()
+    return frames, cpu, emu.stats
+
+
+def bench_gui(args):
+    """Full GUI pipeline when Tk is available, RX threads and merge otherwise"""
+    import roboto_usb2can_tool as tool
+
+    options = [{'bus_bitrate': args.bitrate, 'rx_rate': args.rate, 'rx_ids': (0x100 + i,),
+                'jitter_us': args.jitter_us, 'error_rate': args.error_rate, 'seed': i}
+               for i in range(args.adapters)]
+
+    root = None
+    if tool.tk:
+        try:
+            root = tool.tk.Tk()
+            root.withdraw()
+        except tool.tk.TclError:
+            root = None
+
+    cpu = time.process_time()
+    if root:
+        app = tool.CANToolGUI(root, options)
+        app._connect_all()
+        app._start_bus()
+        root.after(int(args.duration * 1000), root.quit)
+        root.mainloop()
+        frames = app.rx_count
+        stats = [c.transport.stats for c in app.connected_cans]
+        app._disconnect_all()
+        root.destroy()
+        name = "gui"
+    else:
+        merge = MergedCapture()
+        cans = []
+        for opt in options:
+            can = _open(GsUsbEmulator(**opt))
+            can.start_receive(lambda frame, idx=merge.add_adapter(): merge.feed(idx, frame))
+            cans.append(can)
+        merge.start()
+        frames = 0
+        end = time.perf_counter() + args.duration
+        while time.perf_counter() < end:
+            frames += len(merge.get(timeout=0.05))
+        stats = [c.transport.stats for c in cans]
+        for can in cans:
+            can.close()
+        merge.stop()
+        name = "gui (no Tk: rx+merge)"
+    cpu = time.process_time() - cpu
+
+    total = {key: sum(s[key] for s in stats) for key in stats[0]} if stats else {}
+    return frames, cpu, total, name
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="roboto_usb2can host tool benchmark")
+    parser.add_argument('--duration', type=float, default=3.0, help="seconds per path")
+    parser.add_argument('--rate', type=int, default=20000,
+                        help="RX frames/s per emulated adapter (default: 20000)")
+    parser.add_argument('--bitrate', type=int, default=0,
+                        help="emulated bus bitrate, 0 for an unlimited bus (default: 0)")
+    parser.add_argument('--jitter-us', type=float, default=0)
+    parser.add_argument('--error-rate', type=float, default=0,
+                        help="injected protocol errors per second")
+    parser.add_argument('--adapters', type=int, default=2, help="adapters for the GUI path")
+    parser.add_argument('--paths', nargs='+', choices=PATHS, default=list(PATHS))
+    args = parser.parse_args(argv)
+
+    print(f"{'path':<24}{'frames':>10}{'frames/s':>12}{'CPU us/frame':>14}  emulator")
+    baseline = None
+    for path in args.paths:
+        if path == 'gui':
+            frames, cpu, stats, name = bench_gui(args)
+        else:
+            frames, cpu, stats = globals()[f'bench_{path}'](args)
+            name = path
+
+        per_frame = cpu / frames * 1e6 if frames else float('nan')
+        if path == 'emulator':
+            baseline = per_frame
+        note = f"overflow={stats.get('overflow', 0)} errors={stats.get('errors', 0)}"
+        if baseline is not None and path == 'rx_loop':
+            note += f" (tool only: {per_frame - baseline:.1f} us/frame)"
+        print(f"{name:<24}{frames:>10}{frames / args.duration:>12.0f}{per_frame:>14.1f}  {note}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,564 @@
+#!/usr/bin/env python3
+"""
+roboto_usb2can Fan-out Daemon
+Owns the adapters and shares them with multiple host processes:
+- RX frames are published into a shared-memory ring, every reader
+  consumes it at its own pace with its own filter and drop counter
+- TX frames from all clients are merged onto the adapters
+"""
+
+import argparse
+import os
+import queue
+import signal
+import struct
+import sys
+import threading
+import time
+from multiprocessing import shared_memory
+from multiprocessing.connection import Client, Listener
+
+from roboto_usb2can_emulator import GsUsbEmulator
+from roboto_usb2can_tool import (
+    BITRATE_1M, CANFrame, GS_CAN_FEATURE_HW_TIMESTAMP, GS_CAN_FLAG_FD, GS_CAN_MODE_HW_TIMESTAMP,
+    RobopartyCAN,
+)
+
+DEFAULT_SHM_NAME = "roboto_usb2can"
+DEFAULT_ADDRESS = ("127.0.0.1", 29536)
+
+SHM_MAGIC = 0x52554332  # "RUC2"
+SHM_VERSION = 1
+
+# Header: magic, version, max_clients, ring_slots, tx_slots, daemon_pid, write_seq
+HDR_FMT = '<IHHIII4xQ'
+HDR_SIZE = 32
+HDR_WRITE_SEQ_OFF = 24
+
+# RX slot: seq, host timestamp (ns), device index, frame length, frame bytes
+# (gs_usb layout, incl. the device timestamp when the adapter sends one)
+SLOT_HDR_FMT = '<QQHH4x'
+SLOT_HDR_SIZE = 24
+SLOT_DATA_SIZE = 80
+SLOT_SIZE = SLOT_HDR_SIZE + SLOT_DATA_SIZE
+
+# Client entry: state, pid, filter_id, filter_mask, read_seq, rx, drops,
+# filtered, tx_head, tx_tail, tx_drops - followed by its TX ring
+CLIENT_FMT = '<IIIIQQQQQQQ'
+CLIENT_HDR_SIZE = 72
+CLIENT_READ_SEQ_OFF = 16
+CLIENT_RX_OFF = 24
+CLIENT_DROPS_OFF = 32
+CLIENT_FILTERED_OFF = 40
+CLIENT_TX_HEAD_OFF = 48
+CLIENT_TX_TAIL_OFF = 56
+CLIENT_TX_DROPS_OFF = 64
+
+# TX slot: device index, frame length, frame bytes
+TX_SLOT_FMT = '<HH'
+TX_SLOT_SIZE = 4 + SLOT_DATA_SIZE
+
+CLIENT_FREE = 0
+CLIENT_ACTIVE = 1
+
+U64 = struct.Struct('<Q')
+
+# Control channel messages, exchanged with send_bytes()/recv_bytes() so
+# nothing received from a client is ever unpickled
+CTRL_ATTACH = 1
+CTRL_STATS = 2
+CTRL_ERROR = 0xFF
+CTRL_ATTACH_REQ = struct.Struct('<BIII')    # op, pid, filter_id, filter_mask
+CTRL_ATTACH_REPLY = struct.Struct('<Bi')    # op, slot (-1: full), shm name follows
+CTRL_STATS_REPLY = struct.Struct('<BQQI')   # op, write_seq, tx_frames, client count
+# slot, pid, filter_id, filter_mask, lag, rx, drops, filtered, tx_backlog, tx_drops
+CTRL_CLIENT_STATS = struct.Struct('<IIIIqQQQqQ')
+CTRL_MAX_MSG = 64
+
+
+class ShmLayout:
+    """Offsets of the shared-memory segment"""
+
+    def __init__(self, max_clients, ring_slots, tx_slots):
+        if ring_slots & (ring_slots - 1):
+            raise ValueError("ring_slots must be a power of two")
+        self.max_clients = max_clients
+        self.ring_slots = ring_slots
+        self.tx_slots = tx_slots
+        self.ring_off = HDR_SIZE
+        self.clients_off = self.ring_off + ring_slots * SLOT_SIZE
+        self.client_size = CLIENT_HDR_SIZE + tx_slots * TX_SLOT_SIZE
+        self.size = self.clients_off + max_clients * self.client_size
+
+    def slot(self, seq):
+        return self.ring_off + (seq & (self.ring_slots - 1)) * SLOT_SIZE
+
+    def client(self, idx):
+        return self.clients_off + idx * self.client_size
+
+    def tx_slot(self, idx, seq):
+        return self.client(idx) + CLIENT_HDR_SIZE + (seq % self.tx_slots) * TX_SLOT_SIZE
+
+
+def _get_u64(buf, off):
+    return U64.unpack_from(buf, off)[0]
+
+
+def _put_u64(buf, off, value):
+    U64.pack_into(buf, off, value)
+
+
+class CANDaemon:
+    """Owns the adapters and publishes their traffic into shared memory"""
+
+    def __init__(self, cans, shm_name=DEFAULT_SHM_NAME, address=DEFAULT_ADDRESS,
+                 authkey=None, max_clients=8, ring_slots=4096, tx_slots=256):
+        self.cans = cans
+        self.address = address
+        self.authkey = authkey
+        self.layout = ShmLayout(max_clients, ring_slots, tx_slots)
+        self.shm = shared_memory.SharedMemory(name=shm_name, create=True, size=self.layout.size)
+        self.buf = self.shm.buf
+        self.buf[:self.layout.size] = bytes(self.layout.size)
+        struct.pack_into(HDR_FMT, self.buf, 0, SHM_MAGIC, SHM_VERSION, max_clients,
+                         ring_slots, tx_slots, os.getpid(), 0)
+        self.write_seq = 0
+        self.write_lock = threading.Lock()
+        self.slot_lock = threading.Lock()
+        self.running = False
+        self.tx_thread = None
+        self.tx_queues = [queue.Queue(maxsize=tx_slots) for _ in cans]
+        self.tx_workers = []
+        self.listener = None
+        self.tx_sent = [0] * len(cans)
+        self.tx_dropped = 0
+
+    @property
+    def tx_frames(self):
+        return sum(self.tx_sent)
+
+    def publish(self, dev_idx, frame):
+        """Write one RX frame into the ring (seqlock per slot)"""
+        raw = frame.to_bytes()
+        if frame.timestamp_us is not None:
+            # Same place as on the wire: right after the 8 or 64 data bytes
+            raw = raw[:12 + (64 if frame.flags & GS_CAN_FLAG_FD else 8)] + \
+                struct.pack('<I', frame.timestamp_us)
+        with self.write_lock:
+            seq = self.write_seq
+            off = self.layout.slot(seq)
+            _put_u64(self.buf, off, 2 * seq + 1)
+            struct.pack_into('<QHH', self.buf, off + 8, time.perf_counter_ns(), dev_idx, len(raw))
+            self.buf[off + SLOT_HDR_SIZE:off + SLOT_HDR_SIZE + len(raw)] = raw
+            _put_u64(self.buf, off, 2 * seq + 2)
+            self.write_seq = seq + 1
+            _put_u64(self.buf, HDR_WRITE_SEQ_OFF, self.write_seq)
+
+    def _tx_worker(self, dev_idx):
+        """Send the frames queued for one adapter, a stalled adapter only blocks itself"""
+        can = self.cans[dev_idx]
+        tx_queue = self.tx_queues[dev_idx]
+        while True:
+            frame = tx_queue.get()
+            if frame is None:
+                return
+            try:
+                can.send_frame(frame.channel, frame.can_id, frame.data[:frame.can_dlc])
+                self.tx_sent[dev_idx] += 1
+            except Exception as e:
+                print(f"TX error (dev {dev_idx}): {e}")
+
+    def _tx_loop(self):
+        """Merge client TX rings round-robin into the per-adapter TX queues"""
+        layout = self.layout
+        burst = 16
+        while self.running:
+            idle = True
+            for idx in range(layout.max_clients):
+                if self._drain_client(idx, burst):
+                    idle = False
+            if idle:
+                time.sleep(0.0005)
+
+    def _drain_client(self, idx, burst):
+        """Move up to burst frames of one client's TX ring, returns True if any were taken"""
+        layout = self.layout
+        base = layout.client(idx)
+        # The slot must not be handed to a new client between reading and writing its tail
+        with self.slot_lock:
+            if struct.unpack_from('<I', self.buf, base)[0] != CLIENT_ACTIVE:
+                return False
+            head = _get_u64(self.buf, base + CLIENT_TX_HEAD_OFF)
+            tail = _get_u64(self.buf, base + CLIENT_TX_TAIL_OFF)
+            end = min(head, tail + burst)
+            if end <= tail:
+                return False
+            while tail < end:
+                off = layout.tx_slot(idx, tail)
+                dev_idx, length = struct.unpack_from(TX_SLOT_FMT, self.buf, off)
+                frame = CANFrame.from_bytes(bytes(self.buf[off + 4:off + 4 + length]))
+                tail += 1
+                if frame is None or dev_idx >= len(self.cans):
+                    continue
+                try:
+                    self.tx_queues[dev_idx].put_nowait(frame)
+                except queue.Full:
+                    self.tx_dropped += 1
+            _put_u64(self.buf, base + CLIENT_TX_TAIL_OFF, end)
+            return True
+
+    def _attach(self, pid, filter_id, filter_mask):
+        layout = self.layout
+        with self.slot_lock:
+            for idx in range(layout.max_clients):
+                base = layout.client(idx)
+                if struct.unpack_from('<I', self.buf, base)[0] != CLIENT_FREE:
+                    continue
+                self.buf[base:base + CLIENT_HDR_SIZE] = bytes(CLIENT_HDR_SIZE)
+                struct.pack_into('<III', self.buf, base + 4, pid, filter_id, filter_mask)
+                _put_u64(self.buf, base + CLIENT_READ_SEQ_OFF, self.write_seq)
+                struct.pack_into('<I', self.buf, base, CLIENT_ACTIVE)
+                return idx
+        return -1
+
+    def _detach(self, idx):
+        with self.slot_lock:
+            struct.pack_into('<I', self.buf, self.layout.client(idx), CLIENT_FREE)
+
+    def client_stats(self):
+        """Per-client counters: pid, filter, rx, drops, filtered, tx backlog, tx drops"""
+        stats = []
+        for idx in range(self.layout.max_clients):
+            (state, pid, filter_id, filter_mask, read_seq, rx, drops, filtered,
+             tx_head, tx_tail, tx_drops) = struct.unpack_from(CLIENT_FMT, self.buf,
+                                                              self.layout.client(idx))
+            if state != CLIENT_ACTIVE:
+                continue
+            stats.append({
+                'slot': idx, 'pid': pid,
+                'filter': (filter_id, filter_mask),
+                'lag': self.write_seq - read_seq,
+                'rx': rx, 'drops': drops, 'filtered': filtered,
+                'tx_backlog': tx_head - tx_tail, 'tx_drops': tx_drops,
+            })
+        return stats
+
+    def _stats_reply(self):
+        stats = self.client_stats()
+        reply = [CTRL_STATS_REPLY.pack(CTRL_STATS, self.write_seq, self.tx_frames, len(stats))]
+        for s in stats:
+            reply.append(CTRL_CLIENT_STATS.pack(s['slot'], s['pid'], *s['filter'], s['lag'],
+                                                s['rx'], s['drops'], s['filtered'],
+                                                s['tx_backlog'], s['tx_drops']))
+        return b''.join(reply)
+
+    def _serve_client(self, conn):
+        idx = -1
+        try:
+            while self.running:
+                msg = conn.recv_bytes(CTRL_MAX_MSG)
+                op = msg[0] if msg else None
+                if op == CTRL_ATTACH and idx < 0 and len(msg) == CTRL_ATTACH_REQ.size:
+                    idx = self._attach(*CTRL_ATTACH_REQ.unpack(msg)[1:])
+                    conn.send_bytes(CTRL_ATTACH_REPLY.pack(CTRL_ATTACH, idx) +
+                                    self.shm.name.encode())
+                elif op == CTRL_STATS:
+                    conn.send_bytes(self._stats_reply())
+                else:
+                    conn.send_bytes(bytes([CTRL_ERROR]) + f"bad request {msg[:8].hex()}".encode())
+        except (EOFError, OSError):
+            pass
+        finally:
+            if idx >= 0:
+                self._detach(idx)
+            conn.close()
+
+    def _accept_loop(self):
+        while self.running:
+            try:
+                conn = self.listener.accept()
+            except (OSError, EOFError):
+                continue
+            threading.Thread(target=self._serve_client, args=(conn,), daemon=True).start()
+
+    def start(self, bitrate=BITRATE_1M, start_bus=True):
+        self.running = True
+        for i, can in enumerate(self.cans):
+            if start_bus:
+                can.set_bitrate(0, bitrate)
+                # Device timestamps let readers merge adapters on one time base
+                try:
+                    features = can.get_features(0)
+                except Exception:
+                    features = 0
+                can.start_channel(0, GS_CAN_MODE_HW_TIMESTAMP
+                                  if features & GS_CAN_FEATURE_HW_TIMESTAMP else 0)
+            can.start_receive(lambda frame, idx=i: self.publish(idx, frame))
+        self.tx_workers = [threading.Thread(target=self._tx_worker, args=(i,), daemon=True)
+                           for i in range(len(self.cans))]
+        for worker in self.tx_workers:
+            worker.start()
+        self.tx_thread = threading.Thread(target=self._tx_loop, daemon=True)
+        self.tx_thread.start()
+        self.listener = Listener(self.address, authkey=self.authkey)
+        threading.Thread(target=self._accept_loop, daemon=True).start()
+
+    def stop(self):
+        self.running = False
+        # Quiesce TX before the adapters go away
+        if self.tx_thread:
+            self.tx_thread.join()
+        for tx_queue in self.tx_queues:
+            while True:
+                try:
+                    tx_queue.get_nowait()
+                except queue.Empty:
+                    break
+            tx_queue.put(None)
+        for worker in self.tx_workers:
+            worker.join()
+        for can in self.cans:
+            try:
+                can.stop_channel(0)
+            except Exception:
+                pass
+            can.close()
+        if self.listener:
+            self.listener.close()
+        self.buf = None
+        self.shm.close()
+        self.shm.unlink()
+
+
+class DaemonClient:
+    """Reader/writer attached to a running daemon"""
+
+    def __init__(self, address=DEFAULT_ADDRESS, authkey=None, filter_id=0, filter_mask=0):
+        self.conn = Client(address, authkey=authkey)
+        self.conn.send_bytes(CTRL_ATTACH_REQ.pack(CTRL_ATTACH, os.getpid(),
+                                                  filter_id & 0xFFFFFFFF, filter_mask & 0xFFFFFFFF))
+        reply = self.conn.recv_bytes()
+        op, idx = CTRL_ATTACH_REPLY.unpack_from(reply)
+        if op != CTRL_ATTACH or idx < 0:
+            self.conn.close()
+            raise RuntimeError("Daemon has no free client slot")
+        self.shm = shared_memory.SharedMemory(name=reply[CTRL_ATTACH_REPLY.size:].decode())
+        if os.name == 'posix':
+            # The daemon owns the segment, don't let this process unlink it on exit
+            from multiprocessing import resource_tracker
+            resource_tracker.unregister(self.shm._name, 'shared_memory')
+        self.buf = self.shm.buf
+        self.idx = idx
+        magic, version, max_clients, ring_slots, tx_slots, _, _ = \
+            struct.unpack_from(HDR_FMT, self.buf, 0)
+        if magic != SHM_MAGIC or version != SHM_VERSION:
+            raise RuntimeError("Shared memory layout mismatch")
+        self.layout = ShmLayout(max_clients, ring_slots, tx_slots)
+        self.base = self.layout.client(self.idx)
+        self.filter_id = filter_id
+        self.filter_mask = filter_mask
+        self.read_seq = _get_u64(self.buf, self.base + CLIENT_READ_SEQ_OFF)
+        self.rx = 0
+        self.drops = 0
+        self.filtered = 0
+        self.tx_head = _get_u64(self.buf, self.base + CLIENT_TX_HEAD_OFF)
+        self.tx_drops = 0
+
+    def recv(self, max_frames=256, timeout=0.1):
+        """Return up to max_frames new frames, waiting at most timeout seconds"""
+        deadline = time.monotonic() + timeout
+        while True:
+            frames = self._poll(max_frames)
+            if frames or time.monotonic() >= deadline:
+                return frames
+            time.sleep(0.0005)
+
+    def _poll(self, max_frames):
+        buf = self.buf
+        layout = self.layout
+        write_seq = _get_u64(buf, HDR_WRITE_SEQ_OFF)
+        seq = self.read_seq
+        if write_seq - seq > layout.ring_slots:
+            # Lapped by the writer
+            self.drops += write_seq - seq - layout.ring_slots
+            seq = write_seq - layout.ring_slots
+        frames = []
+        while seq < write_seq and len(frames) < max_frames:
+            off = layout.slot(seq)
+            expect = 2 * seq + 2
+            if _get_u64(buf, off) != expect:
+                self.drops += 1
+                seq += 1
+                continue
+            _, t_ns, dev_idx, length = struct.unpack_from(SLOT_HDR_FMT, buf, off)
+            raw = bytes(buf[off + SLOT_HDR_SIZE:off + SLOT_HDR_SIZE + length])
+            if _get_u64(buf, off) != expect:
+                # Overwritten while copying
+                self.drops += 1
+                seq += 1
+                continue
+            seq += 1
+            frame = CANFrame.from_bytes(raw)
+            if frame is None:
+                continue
+            if (frame.can_id & self.filter_mask) != (self.filter_id & self.filter_mask):
+                self.filtered += 1
+                continue
+            frame.dev_idx = dev_idx
+            frame.host_ts = t_ns
+            frames.append(frame)
+        self.rx += len(frames)
+        self.read_seq = seq
+        struct.pack_into('<QQQQ', buf, self.base + CLIENT_READ_SEQ_OFF,
+                         seq, self.rx, self.drops, self.filtered)
+        return frames
+
+    def send_frame(self, channel, can_id, data, dev_idx=0):
+        """Queue a frame for transmission, returns False if the TX ring is full"""
+        tail = _get_u64(self.buf, self.base + CLIENT_TX_TAIL_OFF)
+        if self.tx_head - tail >= self.layout.tx_slots:
+            self.tx_drops += 1
+            _put_u64(self.buf, self.base + CLIENT_TX_DROPS_OFF, self.tx_drops)
+            return False
+        frame = CANFrame()
+        frame.channel = channel
+        frame.can_id = can_id
+        frame.can_dlc = len(data)
+        frame.data[:len(data)] = data
+        raw = frame.to_bytes()
+        off = self.layout.tx_slot(self.idx, self.tx_head)
+        struct.pack_into(TX_SLOT_FMT, self.buf, off, dev_idx, len(raw))
+        self.buf[off + 4:off + 4 + len(raw)] = raw
+        self.tx_head += 1
+        _put_u64(self.buf, self.base + CLIENT_TX_HEAD_OFF, self.tx_head)
+        return True
+
+    def daemon_stats(self):
+        """Return (client stats, frames published, frames transmitted)"""
+        self.conn.send_bytes(bytes([CTRL_STATS]))
+        reply = self.conn.recv_bytes()
+        op, write_seq, tx_frames, count = CTRL_STATS_REPLY.unpack_from(reply)
+        if op != CTRL_STATS:
+            raise RuntimeError(reply[1:].decode(errors='replace'))
+        stats = []
+        for i in range(count):
+            (slot, pid, filter_id, filter_mask, lag, rx, drops, filtered, tx_backlog,
+             tx_drops) = CTRL_CLIENT_STATS.unpack_from(
+                 reply, CTRL_STATS_REPLY.size + i * CTRL_CLIENT_STATS.size)
+            stats.append({
+                'slot': slot, 'pid': pid, 'filter': (filter_id, filter_mask), 'lag': lag,
+                'rx': rx, 'drops': drops, 'filtered': filtered,
+                'tx_backlog': tx_backlog, 'tx_drops': tx_drops,
+            })
+        return stats, write_seq, tx_frames
+
+    def close(self):
+        self.buf = None
+        self.shm.close()
+        self.conn.close()
+
+
+def _open_adapters(backend, emulator_count, emulator_rate):
+    cans = []
+    if backend == 'emulator':
+        for i in range(emulator_count):
+            can = RobopartyCAN(GsUsbEmulator(rx_rate=emulator_rate, rx_ids=(0x100 + i,)))
+            can.open()
+            cans.append(can)
+        return cans
+
+    for dev in RobopartyCAN().find_all():
+        can = RobopartyCAN()
+        try:
+            can.open(device=dev)
+            cans.append(can)
+        except Exception as e:
+            print(f"Failed to open device: {e}")
+    return cans
+
+
+def _print_stats(daemon, elapsed):
+    print(f"[{elapsed:7.1f}s] rx_total={daemon.write_seq} tx_total={daemon.tx_frames} "
+          f"tx_dropped={daemon.tx_dropped}")
+    for s in daemon.client_stats():
+        print(f"    slot {s['slot']} pid {s['pid']}: rx={s['rx']} drops={s['drops']} "
+              f"filtered={s['filtered']} lag={s['lag']} "
+              f"tx_backlog={s['tx_backlog']} tx_drops={s['tx_drops']}")
+
+
+def _run_client(args):
+    """Attach as a reader and report throughput (logger/benchmark)"""
+    client = DaemonClient(filter_id=args.filter_id, filter_mask=args.filter_mask)
+    print(f"Attached to slot {client.idx}")
+    start = last = time.monotonic()
+    count = 0
+    try:
+        while True:
+            frames = client.recv()
+            count += len(frames)
+            if args.verbose:
+                for f in frames:
+                    print(f"[Dev {f.dev_idx}] ID:0x{f.can_id:03X} DLC:{f.can_dlc} "
+                          f"Data:{f.data[:f.can_dlc].hex(' ').upper()}")
+            now = time.monotonic()
+            if now - last >= 1.0:
+                print(f"[{now - start:7.1f}s] {count / (now - last):9.0f} frames/s "
+                      f"rx={client.rx} drops={client.drops} filtered={client.filtered}")
+                count = 0
+                last = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        client.close()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="roboto_usb2can shared-memory fan-out daemon")
+    parser.add_argument('--backend', choices=['usb', 'emulator'], default='usb')
+    parser.add_argument('--emulator-count', type=int, default=1,
+                        help="number of emulated adapters")
+    parser.add_argument('--emulator-rate', type=int, default=0,
+                        help="RX frames/s generated by each emulated adapter")
+    parser.add_argument('--shm-name', default=DEFAULT_SHM_NAME)
+    parser.add_argument('--port', type=int, default=DEFAULT_ADDRESS[1])
+    parser.add_argument('--ring-slots', type=int, default=4096)
+    parser.add_argument('--max-clients', type=int, default=8)
+    parser.add_argument('--no-start', action='store_true', help="don't start the CAN channels")
+    parser.add_argument('--client', action='store_true',
+                        help="attach to a running daemon and report RX rate")
+    parser.add_argument('--filter-id', type=lambda s: int(s, 0), default=0)
+    parser.add_argument('--filter-mask', type=lambda s: int(s, 0), default=0)
+    parser.add_argument('-v', '--verbose', action='store_true')
+    args = parser.parse_args(argv)
+
+    if args.client:
+        _run_client(args)
+        return 0
+
+    cans = _open_adapters(args.backend, args.emulator_count, args.emulator_rate)
+    if not cans:
+        print("No devices found!")
+        return 1
+
+    daemon = CANDaemon(cans, shm_name=args.shm_name, address=(DEFAULT_ADDRESS[0], args.port),
+                       max_clients=args.max_clients, ring_slots=args.ring_slots)
+    daemon.start(start_bus=not args.no_start)
+    print(f"Serving {len(cans)} adapter(s) on shm '{args.shm_name}', port {args.port}")
+
+    # Make sure the shared-memory segment is unlinked when killed
+    signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+
+    start = time.monotonic()
+    try:
+        while True:
+            time.sleep(1)
+            _print_stats(daemon, time.monotonic() - start)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        daemon.stop()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
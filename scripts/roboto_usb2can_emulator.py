@@ -0,0 +1,393 @@
+#!/usr/bin/env python3
+"""
+roboto_usb2can Device Emulator
+In-process gs_usb adapter, used as RobopartyCAN transport without hardware:
+- Control requests (bit timing, mode, BT_CONST, device config, timestamp)
+- TX frames occupy the bus at the configured bitrate and come back as
+  echo frames with their echo_id, like on a real adapter
+- RX traffic generated at an arbitrary rate with timing jitter
+- Injected CAN errors reported as rate-limited SocketCAN error frames on
+  the bulk IN endpoint
+- Frames the host does not read in time overflow the frame pool
+"""
+
+import math
+import random
+import struct
+import threading
+import time
+from collections import deque
+
+import usb.core
+
+from roboto_usb2can_tool import (
+    CAN_ERR_ACK, CAN_ERR_BUSOFF, CAN_ERR_CNT, CAN_ERR_CRTL, CAN_ERR_FLAG, CAN_ERR_PROT,
+    CAN_ERR_SUMMARY_MARKER, CANFrame, GS_CAN_FEATURE_HW_TIMESTAMP,
+    GS_CAN_FLAG_FD, GS_CAN_MODE_HW_TIMESTAMP, GS_USB_CHANNEL_MODE_START, GS_USB_REQUEST_BITTIMING,
+    GS_USB_REQUEST_BT_CONST, GS_USB_REQUEST_DEVICE_CONFIG, GS_USB_REQUEST_HOST_FORMAT,
+    GS_USB_REQUEST_MODE, GS_USB_REQUEST_TIMESTAMP,
+)
+
+# Bits of an 8 byte standard data frame incl. intermission, without stuffing
+FRAME_BITS = 111
+
+# Firmware defaults (CONFIG_USBD_GS_USB_POOL_SIZE, CAN_ERR_REPORT_RATE/BURST/POLL_MS/QUEUE_LEN)
+DEFAULT_POOL_SIZE = 80
+ERR_REPORT_RATE = 20
+ERR_REPORT_BURST = 8
+ERR_REPORT_POLL_S = 0.05
+ERR_REPORT_QUEUE_LEN = 16
+
+# SocketCAN controller/protocol detail bits (linux/can/error.h)
+CAN_ERR_CRTL_RX_OVERFLOW = 0x01
+CAN_ERR_CRTL_RX_WARNING = 0x04
+CAN_ERR_CRTL_TX_WARNING = 0x08
+CAN_ERR_CRTL_RX_PASSIVE = 0x10
+CAN_ERR_CRTL_TX_PASSIVE = 0x20
+CAN_ERR_CRTL_ACTIVE = 0x40
+CAN_ERR_PROT_FORM = 0x02
+CAN_ERR_PROT_STUFF = 0x04
+CAN_ERR_PROT_BIT0 = 0x08
+CAN_ERR_PROT_LOC_CRC_SEQ = 0x08
+CAN_ERR_BUSERROR = 0x00000080
+
+# Injectable errors: (can_id bits, data[1], data[2], data[3], TEC, REC)
+ERROR_KINDS = {
+    'active': (CAN_ERR_CRTL, CAN_ERR_CRTL_ACTIVE, 0, 0, 0, 0),
+    'warning': (CAN_ERR_CRTL, CAN_ERR_CRTL_TX_WARNING, 0, 0, 96, 0),
+    'passive': (CAN_ERR_CRTL, CAN_ERR_CRTL_TX_PASSIVE, 0, 0, 128, 0),
+    'rx-warning': (CAN_ERR_CRTL, CAN_ERR_CRTL_RX_WARNING, 0, 0, 0, 96),
+    'rx-passive': (CAN_ERR_CRTL, CAN_ERR_CRTL_RX_PASSIVE, 0, 0, 0, 128),
+    'bus-off': (CAN_ERR_BUSOFF, 0, 0, 0, 255, 0),
+    'stuff': (CAN_ERR_PROT | CAN_ERR_BUSERROR, 0, CAN_ERR_PROT_STUFF, 0, 0, 8),
+    'form': (CAN_ERR_PROT | CAN_ERR_BUSERROR, 0, CAN_ERR_PROT_FORM, 0, 0, 8),
+    'bit': (CAN_ERR_PROT | CAN_ERR_BUSERROR, 0, CAN_ERR_PROT_BIT0, 0, 8, 0),
+    'crc': (CAN_ERR_PROT | CAN_ERR_BUSERROR, 0, 0, CAN_ERR_PROT_LOC_CRC_SEQ, 0, 8),
+    'ack': (CAN_ERR_ACK | CAN_ERR_BUSERROR, 0, 0, 0, 8, 0),
+}
+PROTOCOL_ERRORS = ('stuff', 'form', 'bit', 'crc', 'ack')
+
+EMU_FCLK = 160000000
+EMU_SW_VERSION = 2
+EMU_HW_VERSION = 1
+
+
+def _stall():
+    return usb.core.USBError('Pipe error', -9, 32)
+
+
+def _timeout():
+    return usb.core.USBTimeoutError('Operation timed out', -7, 110)
+
+
+class GsUsbEmulator:
+    """Emulated single channel gs_usb adapter (RobopartyCAN transport)"""
+
+    instances = 0
+
+    def __init__(self, bus_bitrate=1000000, rx_rate=0, rx_ids=(0x100,), jitter_us=0,
+                 error_rate=0, pool_size=DEFAULT_POOL_SIZE, hw_timestamp=True, seed=None):
+        """
+        bus_bitrate: bus time per frame, 0 for an infinitely fast bus
+        rx_rate: frames/s received from other nodes, capped by the bus
+        jitter_us: random variation of RX arrival and TX echo times
+        error_rate: random protocol errors per second
+        """
+        GsUsbEmulator.instances += 1
+        self.serial = f"EMU{GsUsbEmulator.instances:04d}"
+        self.intf_num = 0
+        self.bus_bitrate = bus_bitrate
+        self.frame_s = FRAME_BITS / bus_bitrate if bus_bitrate else 0.0
+        self.rx_rate = min(rx_rate, 1 / self.frame_s) if self.frame_s else rx_rate
+        self.rx_ids = tuple(rx_ids)
+        self.jitter_s = jitter_us / 1e6
+        self.error_rate = error_rate
+        self.pool_size = pool_size
+        self.features = GS_CAN_FEATURE_HW_TIMESTAMP if hw_timestamp else 0
+        self.rng = random.Random(seed)
+
+        self.cond = threading.Condition()
+        self.is_open = False
+        self.t0 = time.perf_counter()
+        self._reset_channel()
+        self.stats = dict.fromkeys(('tx', 'echo', 'rx', 'read', 'overflow', 'errors',
+                                    'err_suppressed'), 0)
+
+    def _reset_channel(self):
+        self.started = False
+        self.bus_off = False
+        self.mode_flags = 0
+        self.bittiming = None
+        self.in_queue = deque()    # Frames ready for the bulk IN endpoint
+        self.in_flight = deque()   # (bus done time, frame) waiting for the bus
+        self.bus_free = 0.0
+        self.rx_next = 0.0
+        self.rx_seq = 0
+        self.err_next = 0.0
+        self.err_queue = deque()   # Error frames, sent ahead of the frame pool
+        self.err_tokens = ERR_REPORT_BURST * 1.0
+        self.err_refill = 0.0
+        self.err_suppressed = 0
+        self.err_poll_next = 0.0
+        self.overflow_reported = -ERR_REPORT_POLL_S
+
+    def open(self):
+        self.is_open = True
+        return True
+
+    def close(self):
+        with self.cond:
+            self.is_open = False
+            self._reset_channel()
+            self.cond.notify_all()
+
+    def describe(self):
+        """(location, serial number) for device lists"""
+        return "emulator", self.serial
+
+    # ---- Time base ----
+
+    def _now(self):
+        return time.perf_counter() - self.t0
+
+    def _timestamp_us(self, t):
+        return int(t * 1e6) & 0xFFFFFFFF
+
+    def _bus_slot(self, t):
+        """Occupy the bus from t on, returns the end of transmission"""
+        start = max(t, self.bus_free)
+        self.bus_free = start + self.frame_s
+        return self.bus_free + self.rng.uniform(0, self.jitter_s)
+
+    # ---- Frame generation, done lazily up to the current time ----
+
+    def _advance(self, now):
+        if not self.started or self.bus_off:
+            return
+
+        while self.in_flight and self.in_flight[0][0] <= now:
+            done, frame = self.in_flight.popleft()
+            self._deliver(frame, done)
+            self.stats['echo'] += 1
+
+        if self.rx_rate:
+            period = 1 / self.rx_rate
+            due = int((now - self.rx_next) / period) + 1 if self.rx_next <= now else 0
+            room = self.pool_size - len(self.in_queue)
+            if due > room:
+                # Host fell behind: frames beyond the free pool are lost anyway
+                lost = due - max(room, 0)
+                self._deliver_lost(lost, self.rx_next)
+                self.rx_seq += lost
+                self.rx_next += lost * period
+                self.bus_free = max(self.bus_free, self.rx_next)
+            while self.rx_next <= now:
+                done = max(self.rx_next, self.bus_free) + self.frame_s
+                if done > now:
+                    break
+                self.bus_free = done
+                # Jitter varies the inter-arrival time, the mean rate stays the same
+                self.rx_next += max(period + self.rng.uniform(-self.jitter_s, self.jitter_s), 0)
+                frame = CANFrame()
+                frame.can_id = self.rx_ids[self.rx_seq % len(self.rx_ids)]
+                frame.can_dlc = 8
+                frame.data[:8] = struct.pack('<Q', self.rx_seq)
+                self.rx_seq += 1
+                self._deliver(frame, done)
+                self.stats['rx'] += 1
+
+        if self.error_rate:
+            while self.err_next <= now:
+                self.inject_error(self.rng.choice(PROTOCOL_ERRORS), self.err_next)
+                self.err_next += self.rng.expovariate(self.error_rate)
+
+        self._poll_errors(now)
+
+    def _poll_errors(self, now):
+        """Firmware poll work: sends the suppressed count once a token is back"""
+        if now < self.err_poll_next:
+            return
+        if self.err_suppressed:
+            # First poll at which the bucket holds a token again
+            t = max(self.err_poll_next,
+                    self.err_refill + (1 - self.err_tokens) / ERR_REPORT_RATE)
+            t = math.ceil(t / ERR_REPORT_POLL_S) * ERR_REPORT_POLL_S
+            if t <= now:
+                self._refill_tokens(t)
+                self._report_summary(t)
+        self.err_poll_next = (math.floor(now / ERR_REPORT_POLL_S) + 1) * ERR_REPORT_POLL_S
+
+    def _deliver(self, frame, t):
+        """Queue a frame for the host, a full pool drops it like the firmware does"""
+        if len(self.in_queue) >= self.pool_size:
+            self._deliver_lost(1, t)
+            return
+        frame.timestamp_us = self._timestamp_us(t)
+        self.in_queue.append(frame)
+
+    def _deliver_lost(self, count, t):
+        self.stats['overflow'] += count
+        # The firmware picks up RX overruns from the CAN stats on its poll
+        if t - self.overflow_reported >= ERR_REPORT_POLL_S:
+            self.overflow_reported = t
+            self._report_error(CAN_ERR_CRTL, CAN_ERR_CRTL_RX_OVERFLOW, 0, 0, 0, 0, t)
+
+    # ---- Error injection ----
+
+    def inject_error(self, kind, t=None):
+        """Inject a CAN error, one of ERROR_KINDS ('bus-off' stops the controller)"""
+        can_id, ctrl, prot, loc, tec, rec = ERROR_KINDS[kind]
+        with self.cond:
+            t = self._now() if t is None else t
+            if kind == 'bus-off':
+                # Controller stops, pending frames are lost until the host restarts it
+                self.bus_off = True
+                self.in_flight.clear()
+            elif kind == 'active':
+                self.bus_off = False
+            self._report_error(can_id, ctrl, prot, loc, tec, rec, t)
+            self.cond.notify_all()
+
+    def _report_error(self, can_id, ctrl, prot, loc, tec, rec, t):
+        """Queue a SocketCAN error frame through the firmware's token bucket"""
+        self.stats['errors'] += 1
+        self._refill_tokens(t)
+        self._report_summary(t)
+
+        if self.err_tokens < 1 or len(self.err_queue) >= ERR_REPORT_QUEUE_LEN:
+            self.err_suppressed += 1
+            self.stats['err_suppressed'] += 1
+            return
+
+        self.err_tokens -= 1
+        data = bytes([0, ctrl, prot, loc, 0, 0, tec, rec])
+        self._queue_error(self._err_frame(CAN_ERR_FLAG | CAN_ERR_CNT | can_id, data, 0, t))
+
+    def _refill_tokens(self, t):
+        self.err_tokens = min(self.err_tokens + max(t - self.err_refill, 0) * ERR_REPORT_RATE,
+                              ERR_REPORT_BURST)
+        self.err_refill = max(self.err_refill, t)
+
+    def _report_summary(self, t):
+        """Queue the count of suppressed events, the summary costs a token too"""
+        if not self.err_suppressed or self.err_tokens < 1:
+            return
+        self.err_tokens -= 1
+        summary = bytearray(8)
+        struct.pack_into('<I', summary, 2, self.err_suppressed)
+        if self._queue_error(self._err_frame(CAN_ERR_FLAG | CAN_ERR_CRTL, summary,
+                                             CAN_ERR_SUMMARY_MARKER, t)):
+            self.err_suppressed = 0
+
+    def _queue_error(self, frame):
+        if len(self.err_queue) >= ERR_REPORT_QUEUE_LEN:
+            return False
+        self.err_queue.append(frame)
+        return True
+
+    def _err_frame(self, can_id, data, reserved, t):
+        frame = CANFrame.from_bytes(struct.pack('<IIBBBB8s', 0xFFFFFFFF, can_id, 8, 0, 0,
+                                                reserved, bytes(data)))
+        frame.timestamp_us = self._timestamp_us(t)
+        return frame
+
+    # ---- Control endpoint ----
+
+    def ctrl_transfer(self, bmRequestType, bRequest, wValue=0, wIndex=0,
+                      data_or_wLength=None, timeout=None):
+        with self.cond:
+            if bmRequestType == 0x41:
+                self._ctrl_out(bRequest, bytes(data_or_wLength or b''))
+                return len(data_or_wLength or b'')
+            if bmRequestType == 0xC1:
+                return self._ctrl_in(bRequest)[:data_or_wLength]
+            # Gateway/profile requests are not emulated, the firmware stalls them too
+            raise _stall()
+
+    def _ctrl_out(self, bRequest, data):
+        if bRequest == GS_USB_REQUEST_HOST_FORMAT:
+            return
+        if bRequest == GS_USB_REQUEST_BITTIMING:
+            self.bittiming = struct.unpack('<5I', data)
+            return
+        if bRequest == GS_USB_REQUEST_MODE:
+            mode, flags = struct.unpack('<II', data)
+            if mode == GS_USB_CHANNEL_MODE_START:
+                now = self._now()
+                self.started = True
+                self.bus_off = False
+                self.mode_flags = flags
+                self.bus_free = self.rx_next = self.err_next = self.err_refill = now
+            else:
+                self._reset_channel()
+            self.cond.notify_all()
+            return
+        raise _stall()
+
+    def _ctrl_in(self, bRequest):
+        if bRequest == GS_USB_REQUEST_BT_CONST:
+            # feature, fclk, tseg1 min/max, tseg2 min/max, sjw max, brp min/max/inc
+            return struct.pack('<10I', self.features, EMU_FCLK, 1, 256, 1, 128, 128, 1, 512, 1)
+        if bRequest == GS_USB_REQUEST_DEVICE_CONFIG:
+            return struct.pack('<4BII', 0, 0, 0, 0, EMU_SW_VERSION, EMU_HW_VERSION)
+        if bRequest == GS_USB_REQUEST_TIMESTAMP:
+            return struct.pack('<I', self._timestamp_us(self._now()))
+        raise _stall()
+
+    # ---- Bulk endpoints ----
+
+    def write(self, data, timeout=1000):
+        """Bulk OUT: queue a frame for transmission"""
+        frame = CANFrame.from_bytes(bytes(data))
+        deadline = time.perf_counter() + timeout / 1000.0
+        with self.cond:
+            if frame is None or not self.started or self.bus_off:
+                # Nothing transmits, the firmware drops the frame without an echo
+                return len(data)
+
+            # TX buffers are taken from the same pool as RX frames
+            while len(self.in_flight) + len(self.in_queue) >= self.pool_size:
+                self._advance(self._now())
+                wait = min(deadline - time.perf_counter(), self.frame_s or 0.001)
+                if len(self.in_flight) + len(self.in_queue) < self.pool_size:
+                    break
+                if wait <= 0:
+                    raise _timeout()
+                self.cond.wait(wait)
+
+            self.in_flight.append((self._bus_slot(self._now()), frame))
+            self.stats['tx'] += 1
+            self.cond.notify_all()
+        return len(data)
+
+    def read(self, size, timeout=100):
+        """Bulk IN: next frame for the host (one frame per transfer)"""
+        deadline = time.perf_counter() + timeout / 1000.0
+        with self.cond:
+            while True:
+                self._advance(self._now())
+                if self.in_queue or self.err_queue:
+                    break
+                wait = min(self._next_event() - self._now(), deadline - time.perf_counter())
+                if wait <= 0 and time.perf_counter() >= deadline:
+                    raise _timeout()
+                self.cond.wait(max(wait, 0))
+
+            # Error frames use their own transfers, not the gs_usb frame pool
+            frame = self.err_queue.popleft() if self.err_queue else self.in_queue.popleft()
+            self.stats['read'] += 1
+
+        raw = frame.to_bytes()[:12 + (64 if frame.flags & GS_CAN_FLAG_FD else 8)]
+        if self.mode_flags & GS_CAN_MODE_HW_TIMESTAMP:
+            raw += struct.pack('<I', frame.timestamp_us)
+        return raw[:size]
+
+    def _next_event(self):
+        """Time at which the next frame becomes ready"""
+        times = [float('inf')]
+        if self.started and not self.bus_off:
+            if self.in_flight:
+                times.append(self.in_flight[0][0])
+            if self.rx_rate:
+                times.append(max(self.rx_next, self.bus_free) + self.frame_s)
+        return min(times)
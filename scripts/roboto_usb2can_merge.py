@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""
+roboto_usb2can Multi-Adapter Merge
+Orders the RX streams of N adapters into one time-ordered stream:
+- Device timestamps (gs_usb HW timestamp) are unwrapped and mapped onto
+  the host clock with an offset and skew estimate that tracks clock
+  drift, adapters without timestamps use host arrival time
+- Frames are held for at most a bounded reorder window
+- Per-adapter lag and reorder statistics
+"""
+
+import heapq
+import threading
+import time
+from collections import deque
+
+TIMESTAMP_WRAP_US = 1 << 32
+
+# Clock mapping: the lowest USB latency seen in each window is the best
+# offset sample, the skew is fitted over the last CLOCK_WINDOWS of them
+CLOCK_WINDOW_NS = 1_000_000_000
+CLOCK_WINDOWS = 16
+CLOCK_MAX_SKEW = 1e-3
+
+
+class _AdapterStream:
+    """Per-adapter input queue and time base"""
+
+    def __init__(self):
+        self.inbox = deque()
+        self.last_dev_us = None
+        self.wrap_us = 0
+        self.offset_ns = None
+        self.skew = 0.0
+        self.anchor_ns = 0
+        self.window_start_ns = None
+        self.window_min = None
+        self.minima = deque(maxlen=CLOCK_WINDOWS)
+        self.watermark_ns = 0
+        self.last_arrival_ns = 0
+        self.frames = 0
+        self.reordered = 0
+        self.late = 0
+        self.max_lag_ns = 0
+
+    def to_host_ns(self, frame, arrival_ns):
+        """Map the frame onto the host time base"""
+        dev_us = getattr(frame, 'timestamp_us', None)
+        if dev_us is None:
+            return arrival_ns
+
+        # Only a drop by more than half the range is a wrap, smaller backward
+        # steps are frames queued out of order (error frames overtake RX)
+        wrap_us = self.wrap_us
+        in_order = True
+        if self.last_dev_us is not None:
+            step = dev_us - self.last_dev_us
+            if step < -(TIMESTAMP_WRAP_US >> 1):
+                wrap_us = self.wrap_us = self.wrap_us + TIMESTAMP_WRAP_US
+            elif step > TIMESTAMP_WRAP_US >> 1:
+                # Queued before the last wrap
+                wrap_us -= TIMESTAMP_WRAP_US
+                in_order = False
+            elif step < 0:
+                in_order = False
+        if in_order:
+            self.last_dev_us = dev_us
+        dev_ns = (dev_us + wrap_us) * 1000
+
+        offset = arrival_ns - dev_ns
+        if not in_order:
+            # Keep out of the offset/skew minima
+            if self.offset_ns is None:
+                return arrival_ns
+            return min(dev_ns + int(self.offset_ns + self.skew * (dev_ns - self.anchor_ns)),
+                       arrival_ns)
+        if self.window_start_ns is None:
+            self.window_start_ns = dev_ns
+            self.anchor_ns = dev_ns
+        elif dev_ns - self.window_start_ns >= CLOCK_WINDOW_NS:
+            self.minima.append(self.window_min)
+            self.window_start_ns = dev_ns
+            self.window_min = None
+            self._fit_clock()
+        if self.window_min is None or offset < self.window_min[1]:
+            self.window_min = (dev_ns, offset)
+
+        # Never map a frame later than it arrived
+        base = offset - self.skew * (dev_ns - self.anchor_ns)
+        if self.offset_ns is None or base < self.offset_ns:
+            self.offset_ns = base
+        return min(dev_ns + int(self.offset_ns + self.skew * (dev_ns - self.anchor_ns)),
+                   arrival_ns)
+
+    def _fit_clock(self):
+        """Re-anchor offset and skew on the recent per-window latency minima"""
+        points = self.minima
+        self.anchor_ns = points[-1][0]
+        if len(points) < 2:
+            self.skew = 0.0
+        else:
+            n = len(points)
+            mean_t = sum(t for t, _ in points) / n
+            mean_o = sum(o for _, o in points) / n
+            var = sum((t - mean_t) ** 2 for t, _ in points)
+            cov = sum((t - mean_t) * (o - mean_o) for t, o in points)
+            skew = cov / var if var else 0.0
+            self.skew = max(-CLOCK_MAX_SKEW, min(CLOCK_MAX_SKEW, skew))
+        # Lower envelope of the minima along the fitted slope
+        self.offset_ns = min(o - self.skew * (t - self.anchor_ns) for t, o in points)
+
+
+class MergedCapture:
+    """Time-ordered merge of several adapters' RX streams"""
+
+    def __init__(self, window_ms=20, tick_ms=1):
+        self.window_ns = int(window_ms * 1e6)
+        self.tick = tick_ms / 1000.0
+        self.streams = []
+        self.heap = []
+        self.seq = 0
+        self.newest_ns = 0
+        self.released_ns = 0
+        self.out = deque()
+        self.out_cond = threading.Condition()
+        self.running = False
+        self.thread = None
+        self.merge_busy_ns = 0
+        self.merge_start_ns = 0
+        self.epoch_offset_ns = time.time_ns() - time.perf_counter_ns()
+
+    def add_adapter(self):
+        """Register an adapter stream, returns its index for feed()"""
+        self.streams.append(_AdapterStream())
+        return len(self.streams) - 1
+
+    def feed(self, dev_idx, frame):
+        """Called from the adapter RX threads"""
+        self.streams[dev_idx].inbox.append((time.perf_counter_ns(), frame))
+
+    def wall_time(self, ts_ns):
+        """Convert a merge_ts_ns value to seconds since the epoch"""
+        return (ts_ns + self.epoch_offset_ns) / 1e9
+
+    def start(self):
+        self.running = True
+        self.merge_start_ns = time.perf_counter_ns()
+        self.thread = threading.Thread(target=self._merge_loop, daemon=True)
+        self.thread.start()
+
+    def stop(self):
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout=1)
+        self._release(float('inf'))
+
+    def get(self, max_frames=1024, timeout=0.1):
+        """Return up to max_frames frames in timestamp order"""
+        with self.out_cond:
+            if not self.out and timeout:
+                self.out_cond.wait(timeout)
+            frames = []
+            while self.out and len(frames) < max_frames:
+                frames.append(self.out.popleft())
+            return frames
+
+    def stats(self):
+        """Per-adapter counters and merge thread load"""
+        now = time.perf_counter_ns()
+        elapsed = max(now - self.merge_start_ns, 1)
+        result = []
+        for idx, s in enumerate(self.streams):
+            result.append({
+                'dev_idx': idx,
+                'frames': s.frames,
+                'lag_ms': (now - s.watermark_ns) / 1e6 if s.frames else None,
+                'max_lag_ms': s.max_lag_ns / 1e6,
+                'reordered': s.reordered,
+                'late': s.late,
+                'hw_timestamp': s.last_dev_us is not None,
+            })
+        return result, self.merge_busy_ns / elapsed
+
+    def _merge_loop(self):
+        while self.running:
+            t0 = time.perf_counter_ns()
+            self._collect()
+            self._release(self._release_bound(time.perf_counter_ns()))
+            self.merge_busy_ns += time.perf_counter_ns() - t0
+            time.sleep(self.tick)
+
+    def _collect(self):
+        """Move new frames from the adapter inboxes into the reorder heap"""
+        for idx, s in enumerate(self.streams):
+            inbox = s.inbox
+            while inbox:
+                arrival_ns, frame = inbox.popleft()
+                ts = s.to_host_ns(frame, arrival_ns)
+                frame.dev_idx = idx
+                frame.merge_ts_ns = ts
+                s.frames += 1
+                s.last_arrival_ns = arrival_ns
+                if ts > s.watermark_ns:
+                    s.watermark_ns = ts
+                s.max_lag_ns = max(s.max_lag_ns, arrival_ns - ts)
+                if ts < self.released_ns:
+                    # Arrived after the window closed, pass it on out of order
+                    s.late += 1
+                    self._emit([frame])
+                    continue
+                if ts < self.newest_ns:
+                    s.reordered += 1
+                else:
+                    self.newest_ns = ts
+                heapq.heappush(self.heap, (ts, self.seq, frame))
+                self.seq += 1
+
+    def _release_bound(self, now_ns):
+        """Timestamp up to which no adapter can deliver older frames anymore"""
+        horizon = now_ns - self.window_ns
+        bound = now_ns
+        for s in self.streams:
+            bound = min(bound, max(s.watermark_ns, horizon))
+        return bound
+
+    def _release(self, bound):
+        heap = self.heap
+        ready = []
+        while heap and heap[0][0] <= bound:
+            ts, _, frame = heapq.heappop(heap)
+            ready.append(frame)
+        if ready:
+            self.released_ns = ready[-1].merge_ts_ns
+            self._emit(ready)
+
+    def _emit(self, frames):
+        with self.out_cond:
+            self.out.extend(frames)
+            self.out_cond.notify()
@@ -4,8 +4,6 @@ roboto_usb2can Host Tool
 Supports dual-channel CAN transmission and reception
 """
 
-import tkinter as tk
-from tkinter import ttk, scrolledtext, messagebox
 import os
 import sys
 import usb.core
@@ -13,20 +11,61 @@ import usb.util
 import threading
 import time
 import struct
-from queue import Queue
 from datetime import datetime
 import sys
 
+from roboto_usb2can_merge import MergedCapture
+
+try:
+    import tkinter as tk
+    from tkinter import ttk, scrolledtext, messagebox
+except ImportError:
+    # Headless hosts (daemon mode) may not have Tk installed
+    tk = ttk = scrolledtext = messagebox = None
+
 # gs_usb protocol constants
 GS_USB_REQUEST_HOST_FORMAT = 0
 GS_USB_REQUEST_BITTIMING = 1
 GS_USB_REQUEST_MODE = 2
-GS_USB_REQUEST_DEVICE_CONFIG = 9
-GS_USB_REQUEST_BT_CONST = 5
+GS_USB_REQUEST_BT_CONST = 4
+GS_USB_REQUEST_DEVICE_CONFIG = 5
+GS_USB_REQUEST_TIMESTAMP = 6
 
 GS_USB_CHANNEL_MODE_RESET = 0
 GS_USB_CHANNEL_MODE_START = 1
 
+GS_CAN_MODE_HW_TIMESTAMP = 0x10
+GS_CAN_FEATURE_HW_TIMESTAMP = 0x10
+GS_CAN_FLAG_FD = 0x02
+
+# roboto_usb2can vendor requests (device recipient, wIndex selects the request)
+ROBOTO_VENDOR_CODE = 0x01
+ROBOTO_VREQ_GW_ROUTE = 0x0020
+ROBOTO_VREQ_GW_ENABLE = 0x0021
+ROBOTO_VREQ_GW_STATS = 0x0022
+ROBOTO_VREQ_PROFILE = 0x0030
+
+# Firmware build profiles (CONFIG_ROBOTO_PROFILE_ID) and hot-path hooks
+ROBOTO_PROFILES = ('lowest-latency', 'max-throughput', 'min-footprint')
+HOT_PATHS = ('led_event', 'gateway')
+
+# Gateway route flags
+GW_ROUTE_FLAG_IDE = 0x01
+GW_ROUTE_FLAG_REMAP = 0x02
+GW_ROUTE_FLAG_DROP = 0x04
+GW_ROUTE_FLAG_BUS = 0x08
+GW_ROUTE_FLAG_HOST = 0x10
+GW_MAX_ROUTES = 8
+
+# SocketCAN error frame encoding (linux/can/error.h)
+CAN_ERR_FLAG = 0x20000000
+CAN_ERR_CRTL = 0x00000004
+CAN_ERR_PROT = 0x00000008
+CAN_ERR_ACK = 0x00000020
+CAN_ERR_BUSOFF = 0x00000040
+CAN_ERR_CNT = 0x00000200
+CAN_ERR_SUMMARY_MARKER = 0xE5
+
 # Tool Version
 VERSION = "1.0.0"
 
@@ -40,6 +79,7 @@ class CANFrame:
         self.flags = 0
         self.reserved = 0
         self.data = bytearray(64)
+        self.timestamp_us = None
     
     def to_bytes(self):
         """Pack into byte stream"""
@@ -74,11 +114,42 @@ class CANFrame:
                 if available > 0:
                     frame.data[:available] = data[data_offset:]
             
+            # HW timestamp follows the data field (8 bytes classic, 64 bytes FD)
+            ts_offset = data_offset + (64 if frame.flags & GS_CAN_FLAG_FD else 8)
+            if len(data) == ts_offset + 4:
+                frame.timestamp_us = struct.unpack_from('<I', data, ts_offset)[0]
+            
             return frame
             
         except struct.error:
             return None
 
+def describe_error_frame(frame):
+    """Human readable summary of a SocketCAN error frame"""
+    if frame.reserved == CAN_ERR_SUMMARY_MARKER:
+        count = struct.unpack_from('<I', frame.data, 2)[0]
+        return f"{count} error events suppressed (rate limit)"
+
+    parts = []
+    if frame.can_id & CAN_ERR_BUSOFF:
+        parts.append("BUS-OFF")
+    if frame.can_id & CAN_ERR_CRTL:
+        ctrl = frame.data[1]
+        names = [(0x01, "RX-OVERFLOW"), (0x04, "RX-WARNING"), (0x08, "TX-WARNING"),
+                 (0x10, "RX-PASSIVE"), (0x20, "TX-PASSIVE"), (0x40, "ERROR-ACTIVE")]
+        parts += [name for bit, name in names if ctrl & bit]
+    if frame.can_id & CAN_ERR_PROT:
+        prot = frame.data[2]
+        names = [(0x02, "FORM"), (0x04, "STUFF"), (0x08, "BIT0"), (0x10, "BIT1")]
+        parts += [f"{name}-ERR" for bit, name in names if prot & bit]
+        if frame.data[3] == 0x08:
+            parts.append("CRC-ERR")
+    if frame.can_id & CAN_ERR_ACK:
+        parts.append("NO-ACK")
+    if frame.can_id & CAN_ERR_CNT:
+        parts.append(f"TEC={frame.data[6]} REC={frame.data[7]}")
+    return " ".join(parts)
+
 # Bitrate configuration (1Mbps)
 BITRATE_1M = {
     'prop_seg': 15,
@@ -88,29 +159,24 @@ BITRATE_1M = {
     'brp': 4
 }
 
-class RobopartyCAN:
-    def __init__(self):
-        self.dev = None
+class UsbTransport:
+    """gs_usb adapter on the USB bus (pyusb), RobopartyCAN transport"""
+
+    def __init__(self, device=None, vid=0x1D50, pid=0x606F):
+        self.dev = device
+        self.vid = vid
+        self.pid = pid
         self.ep_in = None
         self.ep_out = None
-        self.is_open = False
-        self.rx_thread = None
-        self.rx_running = False
-        self.rx_callback = None
-        
-    def find_all(self, vid=0x1D50, pid=0x606F):
-        """Find all connected devices"""
-        return list(usb.core.find(find_all=True, idVendor=vid, idProduct=pid))
+        self.intf_num = 0
 
-    def open(self, device=None, vid=0x1D50, pid=0x606F):
-        """Open device"""
-        if device:
-            self.dev = device
-        else:
-            self.dev = usb.core.find(idVendor=vid, idProduct=pid)
+    def open(self):
+        """Claim the interface and find the bulk endpoints"""
+        if self.dev is None:
+            self.dev = usb.core.find(idVendor=self.vid, idProduct=self.pid)
             
         if self.dev is None:
-            raise ValueError(f"Device not found (VID=0x{vid:04X}, PID=0x{pid:04X})")
+            raise ValueError(f"Device not found (VID=0x{self.vid:04X}, PID=0x{self.pid:04X})")
         
         try:
             if self.dev.is_kernel_driver_active(0):
@@ -143,18 +209,63 @@ class RobopartyCAN:
         self.ep_in = ep_in
         self.ep_out = ep_out_list[-1]
         self.intf_num = intf.bInterfaceNumber
-        
-        self.is_open = True
         return True
-        
+
     def close(self):
-        """Close device"""
-        self.stop_receive()
         if self.dev:
             try:
                 usb.util.dispose_resources(self.dev)
             except:
                 pass
+
+    def describe(self):
+        """(location, serial number) for device lists"""
+        try:
+            sn = self.dev.serial_number
+        except:
+            sn = "Unknown"
+        return f"{self.dev.bus}/{self.dev.address}", sn
+
+    def ctrl_transfer(self, bmRequestType, bRequest, wValue=0, wIndex=0,
+                      data_or_wLength=None, timeout=None):
+        return self.dev.ctrl_transfer(bmRequestType, bRequest, wValue, wIndex,
+                                      data_or_wLength, timeout)
+
+    def write(self, data, timeout=1000):
+        return self.dev.write(self.ep_out, data, timeout=timeout)
+
+    def read(self, size, timeout=100):
+        return self.dev.read(self.ep_in, size, timeout=timeout)
+
+class RobopartyCAN:
+    def __init__(self, transport=None):
+        """transport: UsbTransport (default) or GsUsbEmulator (roboto_usb2can_emulator)"""
+        self.transport = transport
+        self.intf_num = 0
+        self.is_open = False
+        self.rx_thread = None
+        self.rx_running = False
+        self.rx_callback = None
+        
+    def find_all(self, vid=0x1D50, pid=0x606F):
+        """Find all connected devices"""
+        return list(usb.core.find(find_all=True, idVendor=vid, idProduct=pid))
+
+    def open(self, device=None, vid=0x1D50, pid=0x606F):
+        """Open device"""
+        if self.transport is None:
+            self.transport = UsbTransport(device, vid, pid)
+        self.transport.open()
+        self.intf_num = self.transport.intf_num
+        
+        self.is_open = True
+        return True
+        
+    def close(self):
+        """Close device"""
+        self.stop_receive()
+        if self.transport:
+            self.transport.close()
         self.is_open = False
     
     def set_bitrate(self, channel, bitrate_config):
@@ -166,17 +277,22 @@ class RobopartyCAN:
                            bitrate_config['sjw'],
                            bitrate_config['brp'])
         
-        self.dev.ctrl_transfer(0x41, GS_USB_REQUEST_BITTIMING, channel, self.intf_num, data)
+        self.transport.ctrl_transfer(0x41, GS_USB_REQUEST_BITTIMING, channel, self.intf_num, data)
+    
+    def get_features(self, channel):
+        """Read channel feature flags (GS_CAN_FEATURE_*)"""
+        data = self.transport.ctrl_transfer(0xC1, GS_USB_REQUEST_BT_CONST, channel, self.intf_num, 40)
+        return struct.unpack_from('<I', bytes(data))[0]
     
-    def start_channel(self, channel):
+    def start_channel(self, channel, flags=0):
         """Start CAN channel"""
-        data = struct.pack('<II', GS_USB_CHANNEL_MODE_START, 0)
-        self.dev.ctrl_transfer(0x41, GS_USB_REQUEST_MODE, channel, self.intf_num, data)
+        data = struct.pack('<II', GS_USB_CHANNEL_MODE_START, flags)
+        self.transport.ctrl_transfer(0x41, GS_USB_REQUEST_MODE, channel, self.intf_num, data)
     
     def stop_channel(self, channel):
         """Stop CAN channel"""
         data = struct.pack('<II', GS_USB_CHANNEL_MODE_RESET, 0)
-        self.dev.ctrl_transfer(0x41, GS_USB_REQUEST_MODE, channel, self.intf_num, data)
+        self.transport.ctrl_transfer(0x41, GS_USB_REQUEST_MODE, channel, self.intf_num, data)
     
     def send_frame(self, channel, can_id, data):
         """Send CAN frame"""
@@ -186,18 +302,73 @@ class RobopartyCAN:
         frame.can_dlc = len(data)
         frame.data[:len(data)] = data
         
-        self.dev.write(self.ep_out, frame.to_bytes(), timeout=1000)
+        self.transport.write(frame.to_bytes(), timeout=1000)
     
     def receive_frame(self, timeout=100):
         """Receive CAN frame"""
         try:
-            data = self.dev.read(self.ep_in, 512, timeout=timeout)
+            data = self.transport.read(512, timeout=timeout)
             return CANFrame.from_bytes(bytes(data))
         except usb.core.USBError as e:
             if e.errno == 110:
                 return None
             raise
     
+    def gw_set_route(self, index, match_id, match_mask, new_id=None, drop=False, ext=False,
+                     data_mask=bytes(8), data_value=bytes(8), path=None):
+        """Set gateway route (only while the gateway is disabled)
+
+        path: 'bus' (received frames), 'host' (frames sent by the host) or None for both
+        """
+        flags = GW_ROUTE_FLAG_IDE if ext else 0
+        if new_id is not None:
+            flags |= GW_ROUTE_FLAG_REMAP
+        if drop:
+            flags |= GW_ROUTE_FLAG_DROP
+        if path == 'bus':
+            flags |= GW_ROUTE_FLAG_BUS
+        elif path == 'host':
+            flags |= GW_ROUTE_FLAG_HOST
+        data = struct.pack('<IIIB3x8s8s', match_id, match_mask, new_id or 0, flags,
+                           bytes(data_mask), bytes(data_value))
+        self.transport.ctrl_transfer(0x40, ROBOTO_VENDOR_CODE, index, ROBOTO_VREQ_GW_ROUTE, data)
+    
+    def gw_clear_route(self, index):
+        """Clear gateway route"""
+        self.transport.ctrl_transfer(0x40, ROBOTO_VENDOR_CODE, index, ROBOTO_VREQ_GW_ROUTE, b'')
+    
+    def gw_enable(self, enable=True, bitrate=0):
+        """Enable/disable the gateway, a bitrate starts the bus without a host (standalone)"""
+        data = struct.pack('<I', bitrate) if bitrate else b''
+        self.transport.ctrl_transfer(0x40, ROBOTO_VENDOR_CODE, 1 if enable else 0,
+                               ROBOTO_VREQ_GW_ENABLE, data)
+    
+    def gw_stats(self):
+        """Per-route counters: hits, forwarded, dropped, tx_errors, latency avg/max (ns)"""
+        data = bytes(self.transport.ctrl_transfer(0xC0, ROBOTO_VENDOR_CODE, 0, ROBOTO_VREQ_GW_STATS,
+                                            24 * GW_MAX_ROUTES))
+        keys = ('hits', 'forwarded', 'dropped', 'tx_errors', 'latency_avg_ns', 'latency_max_ns')
+        return [dict(zip(keys, struct.unpack_from('<6I', data, offset)))
+                for offset in range(0, len(data) - 23, 24)]
+    
+    def profile_stats(self):
+        """Build profile and cycles per frame of the firmware hot-path hooks"""
+        data = bytes(self.transport.ctrl_transfer(0xC0, ROBOTO_VENDOR_CODE, 0, ROBOTO_VREQ_PROFILE,
+                                            8 + 12 * 8))
+        profile_id, count, cycles_per_sec = struct.unpack_from('<BB2xI', data, 0)
+        paths = []
+        for i in range(min(count, (len(data) - 8) // 12)):
+            frames, avg, peak = struct.unpack_from('<3I', data, 8 + 12 * i)
+            paths.append({
+                'name': HOT_PATHS[i] if i < len(HOT_PATHS) else f'path{i}',
+                'frames': frames,
+                'avg_cycles': avg,
+                'max_cycles': peak,
+                'avg_ns': avg * 1e9 / cycles_per_sec if cycles_per_sec else 0,
+            })
+        name = ROBOTO_PROFILES[profile_id] if profile_id < len(ROBOTO_PROFILES) else str(profile_id)
+        return name, paths
+    
     def start_receive(self, callback):
         """Start receive thread"""
         self.rx_callback = callback
@@ -226,8 +397,10 @@ class RobopartyCAN:
 
 # Tkinter GUI
 class CANToolGUI:
-    def __init__(self, root):
+    def __init__(self, root, emulator_options=None):
+        """emulator_options: list of GsUsbEmulator keyword arguments, one per emulated adapter"""
         self.root = root
+        self.emulator_options = emulator_options
         self.root.title(f"roboto_usb2can Host Tool v{VERSION}")
         self.root.geometry("1000x800")
         
@@ -252,7 +425,7 @@ class CANToolGUI:
         self.is_bus_started = False
         self.scanned_devices = []
         self.connected_cans = [] 
-        self.rx_queue = Queue()
+        self.rx_merge = None
         
         # Styles
         style = ttk.Style()
@@ -355,7 +528,7 @@ class CANToolGUI:
         self.dev_tree.column("idx", width=40, anchor="center")
         self.dev_tree.column("bus", width=120, anchor="center")
         self.dev_tree.column("sn", width=180, anchor="center")
-        self.dev_tree.column("status", width=100, anchor="center")
+        self.dev_tree.column("status", width=260, anchor="center")
         
         scrollbar = ttk.Scrollbar(dev_frame, orient=tk.VERTICAL, command=self.dev_tree.yview)
         self.dev_tree.configure(yscrollcommand=scrollbar.set)
@@ -367,6 +540,7 @@ class CANToolGUI:
         self.periodic_thread = None
         self.periodic_running = False
         self.rx_count = 0
+        self.stats_time = 0
 
     def refresh_devices_list(self):
         """Scan only, don't auto connect"""
@@ -375,28 +549,29 @@ class CANToolGUI:
         # If connected, show connected devices info
         if self.is_connected:
             for i, can in enumerate(self.connected_cans):
-                dev = can.dev
-                try:
-                    sn = dev.serial_number
-                except:
-                    sn = "Unknown"
-                self.dev_tree.insert("", "end", values=(i, f"{dev.bus}/{dev.address}", sn, "Connected"))
+                location, sn = can.transport.describe()
+                self.dev_tree.insert("", "end", iid=str(i), values=(i, location, sn, "Connected"))
         else:
             # Scan for available devices
             try:
-                found = list(usb.core.find(find_all=True, idVendor=0x1D50, idProduct=0x606F))
-                for i, dev in enumerate(found):
-                    try:
-                        sn = dev.serial_number
-                    except:
-                        sn = "Unknown"
-                    self.dev_tree.insert("", "end", values=(i, f"{dev.bus}/{dev.address}", sn, "Available"))
+                found = self._scan_transports()
+                for i, transport in enumerate(found):
+                    location, sn = transport.describe()
+                    self.dev_tree.insert("", "end", values=(i, location, sn, "Available"))
                 
                 if not found:
                     self.dev_tree.insert("", "end", values=("-", "-", "No devices found", "-"))
             except Exception as e:
                 print(f"Scan error: {e}")
 
+    def _scan_transports(self):
+        """Transports of all adapters, emulated ones when running with --emulate"""
+        if self.emulator_options is not None:
+            from roboto_usb2can_emulator import GsUsbEmulator
+            return [GsUsbEmulator(**options) for options in self.emulator_options]
+        found = usb.core.find(find_all=True, idVendor=0x1D50, idProduct=0x606F)
+        return [UsbTransport(dev) for dev in found]
+
     def toggle_connect(self):
         """Handle Connect/Disconnect"""
         if self.is_connected:
@@ -406,20 +581,20 @@ class CANToolGUI:
 
     def _connect_all(self):
         try:
-            found = list(usb.core.find(find_all=True, idVendor=0x1D50, idProduct=0x606F))
+            found = self._scan_transports()
             if not found:
                 messagebox.showerror("Error", "No devices found!")
                 return
 
             count = 0
-            for i, dev in enumerate(found):
+            merge = MergedCapture()
+            for transport in found:
                 try:
-                    can_wrapper = RobopartyCAN()
-                    can_wrapper.open(device=dev)
+                    can_wrapper = RobopartyCAN(transport)
+                    can_wrapper.open()
                     
-                    def rx_callback(frame, idx=i):
-                        frame.dev_idx = idx
-                        self.rx_queue.put(frame)
+                    def rx_callback(frame, idx=merge.add_adapter()):
+                        merge.feed(idx, frame)
                         
                     can_wrapper.start_receive(rx_callback)
                     self.connected_cans.append(can_wrapper)
@@ -428,6 +603,8 @@ class CANToolGUI:
                     print(f"Failed to connect device: {e}")
             
             if count > 0:
+                merge.start()
+                self.rx_merge = merge
                 self.is_connected = True
                 self.btn_connect.config(text="Disconnect All")
                 self.btn_bus.config(state="normal")
@@ -452,6 +629,9 @@ class CANToolGUI:
             except:
                 pass
         self.connected_cans = []
+        if self.rx_merge:
+            self.rx_merge.stop()
+            self.rx_merge = None
         
         self.is_connected = False
         self.btn_connect.config(text="Connect All")
@@ -474,7 +654,13 @@ class CANToolGUI:
         try:
             for c in self.connected_cans:
                 c.set_bitrate(0, BITRATE_1M)
-                c.start_channel(0)
+                # Device timestamps give the merged log a common time base
+                try:
+                    features = c.get_features(0)
+                except Exception:
+                    features = 0
+                flags = GS_CAN_MODE_HW_TIMESTAMP if features & GS_CAN_FEATURE_HW_TIMESTAMP else 0
+                c.start_channel(0, flags)
             
             self.is_bus_started = True
             self.btn_bus.config(text="Stop CAN")
@@ -569,13 +755,41 @@ class CANToolGUI:
         self.rx_count = 0
         self.rx_count_label.config(text="Rx: 0")
 
+    def _update_merge_stats(self):
+        """Show per-adapter lag and reorder counters in the device list"""
+        stats, _ = self.rx_merge.stats()
+        for s in stats:
+            if not self.dev_tree.exists(str(s['dev_idx'])):
+                continue
+            lag = "-" if s['lag_ms'] is None else f"{s['lag_ms']:.1f}ms"
+            ts_src = "HW" if s['hw_timestamp'] else "Host"
+            status = f"Connected | {ts_src} Lag:{lag} Reord:{s['reordered']} Late:{s['late']}"
+            self.dev_tree.set(str(s['dev_idx']), "status", status)
+
     def _update_rx_display(self):
-        while not self.rx_queue.empty():
-            frame = self.rx_queue.get()
-            
+        frames = self.rx_merge.get(timeout=0) if self.rx_merge else []
+        
+        now = time.monotonic()
+        if self.rx_merge and now - self.stats_time >= 1.0:
+            self.stats_time = now
+            self._update_merge_stats()
+        
+        for frame in frames:
             if frame.can_id == 0 and frame.can_dlc == 0:
                 continue
             
+            dev_idx = getattr(frame, 'dev_idx', '?')
+            # Merged time base: device timestamp mapped onto the host clock
+            timestamp = datetime.fromtimestamp(
+                self.rx_merge.wall_time(frame.merge_ts_ns)).strftime("%H:%M:%S.%f")[:-3]
+            
+            if frame.can_id & CAN_ERR_FLAG:
+                msg = f"[{timestamp}] [Dev {dev_idx}] ERR {describe_error_frame(frame)}\n"
+                self.recv_text.insert(tk.END, msg, "err")
+                self.recv_text.tag_config("err", foreground="red")
+                self.recv_text.see(tk.END)
+                continue
+            
             # Simple Filter
             filter_id = self.filter_var.get().strip()
             if filter_id:
@@ -588,10 +802,8 @@ class CANToolGUI:
             self.rx_count += 1
             self.rx_count_label.config(text=f"Rx: {self.rx_count}")
             
-            timestamp = datetime.now().strftime("%H:%M:%S.%f")[:-3]
             data_hex = frame.data[:frame.can_dlc].hex(' ').upper()
             
-            dev_idx = getattr(frame, 'dev_idx', '?')
             msg = f"[{timestamp}] [Dev {dev_idx}] ID:0x{frame.can_id:03X} DLC:{frame.can_dlc} Data:{data_hex}\n"
             
             self.recv_text.insert(tk.END, msg, "rx")
@@ -604,10 +816,49 @@ class CANToolGUI:
         
         self.root.after(50, self._update_rx_display)
             
+def profile_report():
+    """Print the firmware build profile and hot-path cycles per frame"""
+    devices = RobopartyCAN().find_all()
+    if not devices:
+        print("No roboto_usb2can device found")
+        return 1
+
+    for i, dev in enumerate(devices):
+        can = RobopartyCAN()
+        try:
+            can.open(dev)
+            name, paths = can.profile_stats()
+        except usb.core.USBError as e:
+            print(f"Device {i}: no hot-path counters ({e}), firmware built without "
+                  "CONFIG_ROBOTO_HOT_PATH_STATS?")
+            continue
+        finally:
+            can.close()
+
+        print(f"Device {i}: profile {name}")
+        for p in paths:
+            print(f"  {p['name']:<10} {p['frames']:>10} frames  avg {p['avg_cycles']:>6} cycles "
+                  f"({p['avg_ns']:.0f} ns)  max {p['max_cycles']} cycles")
+    return 0
+
 def main():
+    if len(sys.argv) > 1 and sys.argv[1] == "--daemon":
+        import roboto_usb2can_daemon
+        return roboto_usb2can_daemon.main(sys.argv[2:])
+
+    if len(sys.argv) > 1 and sys.argv[1] == "--profile-report":
+        return profile_report()
+
+    # Hardware-free GUI: --emulate [adapters] [RX frames/s per adapter]
+    emulator_options = None
+    if len(sys.argv) > 1 and sys.argv[1] == "--emulate":
+        count = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+        rate = int(sys.argv[3]) if len(sys.argv) > 3 else 100
+        emulator_options = [{'rx_rate': rate, 'rx_ids': (0x100 + i,)} for i in range(count)]
+
     root = tk.Tk()
-    app = CANToolGUI(root)
+    app = CANToolGUI(root, emulator_options)
     root.mainloop()
 
 if __name__ == "__main__":
-    main()
\ No newline at end of file
+    sys.exit(main())
\ No newline at end of file
@@ -23,7 +23,7 @@ if [ "$EUID" -ne 0 ]; then
 fi
 
 # Exit trap: Clean up background processes
-trap 'echo -e "\nStopping test..."; sudo killall cangen 2>/dev/null; exit' INT
+trap 'echo -e "\nStopping test..."; sudo killall cangen candump 2>/dev/null; exit' INT
 
 echo ">>> Initializing CAN interfaces (Mode: Classic CAN 2.0)..."
 echo "    Bitrate: $BITRATE bps"
@@ -74,6 +74,18 @@ for IF in "${INTERFACES[@]}"; do
     fi
 done
 
+echo ">>> Starting error frame capture..."
+
+# --- Error Frame Capture Loop ---
+# The firmware sends bus errors as SocketCAN error frames on the gs_usb
+# bulk IN endpoint; capture only those (no data frames, all error classes)
+for IF in "${INTERFACES[@]}"; do
+    if [ -d "/sys/class/net/$IF" ]; then
+        : > "/tmp/roboto_err_$IF.log"
+        candump -t a -e "$IF,0~0,#FFFFFFFF" > "/tmp/roboto_err_$IF.log" 2>/dev/null &
+    fi
+done
+
 echo ">>> Starting dashboard..."
 sleep 1
 
@@ -98,7 +110,7 @@ while true; do
     echo "      4-Channel CAN Multi-Node Interconnection Stress Test - $(date +%T)"
     echo "      (Transmit Interval: ${TEST_INTERVAL}ms | Auto Recovery: 100ms)"
     echo "========================================================================"
-    printf "%-6s %-12s %-12s %-8s %-12s %-15s\n" "IFace" "Rate(TX/RX)" "Total Pkts(T/R)" "Errors(T/R)" "State" "HW Cnt(TEC/REC)"
+    printf "%-6s %-12s %-12s %-8s %-12s %-15s %-8s\n" "IFace" "Rate(TX/RX)" "Total Pkts(T/R)" "Errors(T/R)" "State" "HW Cnt(TEC/REC)" "ErrFrames"
     echo "------------------------------------------------------------------------"
 
     for IF in "${INTERFACES[@]}"; do
@@ -120,6 +132,10 @@ while true; do
             berr_info=$(ip -d link show $IF | grep "berr-counter" | sed -E 's/.*berr-counter tx ([0-9]+) rx ([0-9]+).*/TX:\1 RX:\2/')
             if [ -z "$berr_info" ]; then berr_info="N/A"; fi
 
+            # Error frames received through SocketCAN (candump -e capture)
+            err_frames=$(grep -c "ERRORFRAME" "/tmp/roboto_err_$IF.log" 2>/dev/null)
+            [ -z "$err_frames" ] && err_frames=0
+
             # Calculated display ID
             hex_id="Random"
 
@@ -132,8 +148,8 @@ while true; do
             if [ "$can_state" != "ERROR-ACTIVE" ]; then state_color="\033[31m"; fi # Red for non-ACTIVE
 
             # Print row
-            printf "%-6s %-12s %-12s %-8s ${state_color}%-12s\033[0m %-15s\n" \
-                "$IF" "${tx_rate}/${rx_rate}" "${tx_new}/${rx_new}" "${errors}/${rx_errors}" "$can_state" "$berr_info"
+            printf "%-6s %-12s %-12s %-8s ${state_color}%-12s\033[0m %-15s %-8s\n" \
+                "$IF" "${tx_rate}/${rx_rate}" "${tx_new}/${rx_new}" "${errors}/${rx_errors}" "$can_state" "$berr_info" "$err_frames"
 
             # Update old values
             rx_old[$IF]=$rx_new
@@ -142,6 +158,10 @@ while true; do
     done
 
     echo "========================================================================"
+    for IF in "${INTERFACES[@]}"; do
+        last_err=$(grep "ERRORFRAME" "/tmp/roboto_err_$IF.log" 2>/dev/null | tail -1)
+        [ -n "$last_err" ] && echo " Last error frame $IF:${last_err#*$IF}"
+    done
     echo " Tuning Note: Attempted to set MTU to 16 to optimize USB transmission efficiency."
     echo " Operation Tip: Press Ctrl+C to stop the test and shut down all traffic sources."
 done
\ No newline at end of file
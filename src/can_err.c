@@ -0,0 +1,393 @@
+/*
+ * CAN error frame reporting for roboto_usb2can
+ */
+
+#include "roboto_usb2can.h"
+
+#ifdef CONFIG_USB_DEVICE_STACK_NEXT
+#include <zephyr/sys/iterable_sections.h>
+#endif
+
+LOG_MODULE_REGISTER(can_err, LOG_LEVEL_INF);
+
+K_MSGQ_DEFINE(can_err_msgq, sizeof(struct can_err_host_frame), CAN_ERR_REPORT_QUEUE_LEN, 4);
+
+/* Token bucket limiting error frames sent to the host */
+static struct k_spinlock can_err_lock;
+static uint32_t can_err_tokens = CAN_ERR_REPORT_BURST * 1000U; /* in milli-tokens */
+static int64_t can_err_refill_ms;
+static uint32_t can_err_suppressed;
+
+/* Protocol error counters at the last poll */
+struct can_err_stats_snapshot {
+	uint32_t bit0;
+	uint32_t bit1;
+	uint32_t stuff;
+	uint32_t form;
+	uint32_t crc;
+	uint32_t ack;
+	uint32_t rx_overruns;
+};
+
+static struct can_err_stats_snapshot can_err_snapshots[ARRAY_SIZE(can_devices)];
+static struct k_work_delayable can_err_poll_work;
+
+#ifdef CONFIG_USB_DEVICE_STACK_NEXT
+/*
+ * Error frames are sent on the gs_usb bulk IN endpoint next to the RX
+ * frames. The class request callback is interposed so completions of our
+ * own transfers are released here and everything else reaches gs_usb.
+ */
+static struct usbd_class_data *can_err_c_data;
+static const struct usbd_class_api *can_err_gs_usb_api;
+static struct usbd_class_api can_err_class_api;
+static uint8_t can_err_ep_in;
+static struct net_buf *can_err_in_bufs[CAN_ERR_REPORT_IN_FLIGHT];
+static struct k_work can_err_in_work;
+#endif
+
+/* Take one token, refilling the bucket first. Must hold can_err_lock */
+static bool can_err_take_token(void)
+{
+	int64_t now = k_uptime_get();
+	/* Time needed to refill an empty bucket caps the elapsed time */
+	uint32_t elapsed = MIN(now - can_err_refill_ms, CAN_ERR_REPORT_BURST * 1000U);
+	uint32_t refill = elapsed * CAN_ERR_REPORT_RATE;
+
+	can_err_refill_ms = now;
+	can_err_tokens = MIN(can_err_tokens + refill, CAN_ERR_REPORT_BURST * 1000U);
+
+	if (can_err_tokens < 1000U) {
+		return false;
+	}
+
+	can_err_tokens -= 1000U;
+	return true;
+}
+
+/* Queue the count of suppressed events, the summary costs a token too.
+ * Must hold can_err_lock
+ */
+static void can_err_put_summary(uint8_t ch)
+{
+	struct can_err_host_frame summary = {
+		.echo_id = UINT32_MAX,
+		.can_id = SOCKETCAN_ERR_FLAG | SOCKETCAN_ERR_CRTL,
+		.can_dlc = SOCKETCAN_ERR_DLC,
+		.channel = ch,
+	};
+
+	if (can_err_suppressed == 0 || !can_err_take_token()) {
+		return;
+	}
+
+	sys_put_le32(can_err_suppressed, &summary.data[CAN_ERR_SUMMARY_COUNT_OFFSET]);
+	summary.reserved = CAN_ERR_SUMMARY_MARKER;
+
+	if (k_msgq_put(&can_err_msgq, &summary, K_NO_WAIT) == 0) {
+		can_err_suppressed = 0;
+	}
+}
+
+/* Queue an error frame for the host, subject to the rate limit */
+static void can_err_submit(struct can_err_host_frame *frame)
+{
+	k_spinlock_key_t key = k_spin_lock(&can_err_lock);
+
+	/* Report suppressed events first */
+	can_err_put_summary(frame->channel);
+
+	if (!can_err_take_token() || k_msgq_put(&can_err_msgq, frame, K_NO_WAIT) != 0) {
+		can_err_suppressed++;
+	}
+
+	k_spin_unlock(&can_err_lock, key);
+}
+
+/* Fill class and data bits for protocol errors since the last poll.
+ * Only called from the poll work item, which owns can_err_snapshots.
+ */
+static bool can_err_fill_protocol(uint8_t ch, struct can_err_host_frame *frame)
+{
+#ifdef CONFIG_CAN_STATS
+	const struct device *dev = can_devices[ch];
+	struct can_err_stats_snapshot *last = &can_err_snapshots[ch];
+	struct can_err_stats_snapshot cur = {
+		.bit0 = can_stats_get_bit0_errors(dev),
+		.bit1 = can_stats_get_bit1_errors(dev),
+		.stuff = can_stats_get_stuff_errors(dev),
+		.form = can_stats_get_form_errors(dev),
+		.crc = can_stats_get_crc_errors(dev),
+		.ack = can_stats_get_ack_errors(dev),
+		.rx_overruns = can_stats_get_rx_overruns(dev),
+	};
+	uint8_t prot = 0;
+
+	if (cur.bit0 != last->bit0) {
+		prot |= SOCKETCAN_ERR_PROT_BIT0;
+	}
+	if (cur.bit1 != last->bit1) {
+		prot |= SOCKETCAN_ERR_PROT_BIT1;
+	}
+	if (cur.stuff != last->stuff) {
+		prot |= SOCKETCAN_ERR_PROT_STUFF;
+	}
+	if (cur.form != last->form) {
+		prot |= SOCKETCAN_ERR_PROT_FORM;
+	}
+	if (cur.crc != last->crc) {
+		frame->data[3] = SOCKETCAN_ERR_PROT_LOC_CRC_SEQ;
+	}
+	if (prot != 0 || cur.crc != last->crc) {
+		frame->can_id |= SOCKETCAN_ERR_PROT | SOCKETCAN_ERR_BUSERROR;
+		frame->data[2] = prot;
+	}
+	if (cur.ack != last->ack) {
+		frame->can_id |= SOCKETCAN_ERR_ACK | SOCKETCAN_ERR_BUSERROR;
+	}
+	if (cur.rx_overruns != last->rx_overruns) {
+		frame->can_id |= SOCKETCAN_ERR_CRTL;
+		frame->data[1] |= SOCKETCAN_ERR_CRTL_RX_OVERFLOW;
+	}
+
+	*last = cur;
+	return (frame->can_id & ~SOCKETCAN_ERR_FLAG) != 0;
+#else
+	ARG_UNUSED(ch);
+	ARG_UNUSED(frame);
+	return false;
+#endif
+}
+
+/* Initialise an error frame with the current TEC/REC */
+static void can_err_frame_init(uint8_t ch, struct can_err_host_frame *frame,
+			       struct can_bus_err_cnt err_cnt)
+{
+	*frame = (struct can_err_host_frame){
+		.echo_id = UINT32_MAX,
+		.can_id = SOCKETCAN_ERR_FLAG | SOCKETCAN_ERR_CNT,
+		.can_dlc = SOCKETCAN_ERR_DLC,
+		.channel = ch,
+	};
+
+	frame->data[6] = MIN(err_cnt.tx_err_cnt, UINT8_MAX);
+	frame->data[7] = MIN(err_cnt.rx_err_cnt, UINT8_MAX);
+}
+
+/* Periodic poll of the protocol error counters */
+static void can_err_poll_handler(struct k_work *work)
+{
+	struct can_err_host_frame frame;
+	struct can_bus_err_cnt err_cnt;
+	enum can_state state;
+
+	for (int ch = 0; ch < ARRAY_SIZE(can_devices); ch++) {
+		if (can_get_state(can_devices[ch], &state, &err_cnt) != 0 ||
+		    state == CAN_STATE_STOPPED) {
+			continue;
+		}
+
+		can_err_frame_init(ch, &frame, err_cnt);
+		if (can_err_fill_protocol(ch, &frame)) {
+			can_err_submit(&frame);
+		}
+	}
+
+	/* Report what an error storm suppressed once tokens are back, even
+	 * when no new error follows it
+	 */
+	if (can_err_suppressed > 0) {
+		k_spinlock_key_t key = k_spin_lock(&can_err_lock);
+
+		can_err_put_summary(0);
+		k_spin_unlock(&can_err_lock, key);
+	}
+
+#ifdef CONFIG_USB_DEVICE_STACK_NEXT
+	/* Retry frames queued while the host was not connected */
+	k_work_submit(&can_err_in_work);
+#endif
+
+	k_work_reschedule(&can_err_poll_work, K_MSEC(CAN_ERR_REPORT_POLL_MS));
+}
+
+/* Report a CAN state change to the host */
+void can_err_report_state(uint8_t ch, enum can_state state, struct can_bus_err_cnt err_cnt)
+{
+	struct can_err_host_frame frame;
+
+	can_err_frame_init(ch, &frame, err_cnt);
+
+	switch (state) {
+	case CAN_STATE_ERROR_ACTIVE:
+		frame.can_id |= SOCKETCAN_ERR_CRTL;
+		frame.data[1] = SOCKETCAN_ERR_CRTL_ACTIVE;
+		break;
+
+	case CAN_STATE_ERROR_WARNING:
+		frame.can_id |= SOCKETCAN_ERR_CRTL;
+		if (err_cnt.tx_err_cnt >= 96) {
+			frame.data[1] |= SOCKETCAN_ERR_CRTL_TX_WARNING;
+		}
+		if (err_cnt.rx_err_cnt >= 96) {
+			frame.data[1] |= SOCKETCAN_ERR_CRTL_RX_WARNING;
+		}
+		break;
+
+	case CAN_STATE_ERROR_PASSIVE:
+		frame.can_id |= SOCKETCAN_ERR_CRTL;
+		if (err_cnt.tx_err_cnt >= 128) {
+			frame.data[1] |= SOCKETCAN_ERR_CRTL_TX_PASSIVE;
+		}
+		if (err_cnt.rx_err_cnt >= 128) {
+			frame.data[1] |= SOCKETCAN_ERR_CRTL_RX_PASSIVE;
+		}
+		break;
+
+	case CAN_STATE_BUS_OFF:
+		frame.can_id |= SOCKETCAN_ERR_BUSOFF;
+		break;
+
+	default:
+		/* STOPPED is requested by the host, nothing to report */
+		return;
+	}
+
+	can_err_submit(&frame);
+
+	/* Report the protocol errors that led to the state change right away */
+	k_work_reschedule(&can_err_poll_work, K_NO_WAIT);
+}
+
+#ifdef CONFIG_USB_DEVICE_STACK_NEXT
+/* Replace the first bulk IN slot holding match with buf, returns the slot or -1 */
+static int can_err_in_slot(struct net_buf *match, struct net_buf *buf)
+{
+	k_spinlock_key_t key = k_spin_lock(&can_err_lock);
+	int slot = -1;
+
+	for (int i = 0; i < ARRAY_SIZE(can_err_in_bufs); i++) {
+		if (can_err_in_bufs[i] == match) {
+			can_err_in_bufs[i] = buf;
+			slot = i;
+			break;
+		}
+	}
+
+	k_spin_unlock(&can_err_lock, key);
+
+	return slot;
+}
+
+/* Move queued error frames onto the gs_usb bulk IN endpoint */
+static void can_err_in_handler(struct k_work *work)
+{
+	struct can_err_host_frame frame;
+	struct net_buf *buf;
+	int slot;
+
+	if (can_err_c_data == NULL) {
+		return;
+	}
+
+	while (k_msgq_peek(&can_err_msgq, &frame) == 0) {
+		buf = usbd_ep_buf_alloc(can_err_c_data, can_err_ep_in, CAN_ERR_IN_FRAME_SIZE);
+		if (buf == NULL) {
+			return;
+		}
+
+		slot = can_err_in_slot(NULL, buf);
+		if (slot < 0) {
+			usbd_ep_buf_free(usbd_class_get_ctx(can_err_c_data), buf);
+			return;
+		}
+
+		net_buf_add_mem(buf, &frame, sizeof(frame));
+#ifdef CONFIG_USBD_GS_USB_TIMESTAMP
+		net_buf_add_le32(buf, roboto_timestamp_us());
+#endif
+
+		if (usbd_ep_enqueue(can_err_c_data, buf) != 0) {
+			/* Not configured by the host yet, keep the frame queued */
+			can_err_in_slot(buf, NULL);
+			usbd_ep_buf_free(usbd_class_get_ctx(can_err_c_data), buf);
+			return;
+		}
+
+		k_msgq_get(&can_err_msgq, &frame, K_NO_WAIT);
+	}
+}
+
+/* gs_usb class request callback with our own transfers filtered out */
+static int can_err_class_request(struct usbd_class_data *const c_data, struct net_buf *buf,
+				 int err)
+{
+	if (can_err_in_slot(buf, NULL) < 0) {
+		return can_err_gs_usb_api->request(c_data, buf, err);
+	}
+
+	usbd_ep_buf_free(usbd_class_get_ctx(c_data), buf);
+	k_work_submit(&can_err_in_work);
+
+	return 0;
+}
+
+/* Bulk IN endpoint address of a class instance, 0 if none */
+static uint8_t can_err_find_ep_in(struct usbd_class_data *c_data)
+{
+	struct usb_desc_header **dhp = c_data->api->get_desc(c_data, USBD_SPEED_FS);
+
+	for (; dhp != NULL && *dhp != NULL && (*dhp)->bLength != 0; dhp++) {
+		struct usb_ep_descriptor *ed = (struct usb_ep_descriptor *)*dhp;
+
+		if (ed->bDescriptorType == USB_DESC_ENDPOINT &&
+		    USB_EP_DIR_IS_IN(ed->bEndpointAddress) &&
+		    (ed->bmAttributes & USB_EP_TRANSFER_TYPE_MASK) == USB_EP_TYPE_BULK) {
+			return ed->bEndpointAddress;
+		}
+	}
+
+	return 0;
+}
+
+int can_err_report_attach(const char *class_name)
+{
+	STRUCT_SECTION_FOREACH_ALTERNATE(usbd_class_fs, usbd_class_node, c_nd) {
+		if (strcmp(c_nd->c_data->name, class_name) != 0) {
+			continue;
+		}
+
+		can_err_ep_in = can_err_find_ep_in(c_nd->c_data);
+		if (can_err_ep_in == 0) {
+			return -ENOENT;
+		}
+
+		can_err_c_data = c_nd->c_data;
+		can_err_gs_usb_api = can_err_c_data->api;
+		can_err_class_api = *can_err_gs_usb_api;
+		can_err_class_api.request = can_err_class_request;
+		can_err_c_data->api = &can_err_class_api;
+
+		LOG_INF("CAN error frames on %s endpoint 0x%02x", class_name, can_err_ep_in);
+
+		return 0;
+	}
+
+	return -ENODEV;
+}
+#endif
+
+/* Initialize CAN error frame reporting */
+void can_err_report_init(void)
+{
+	can_err_refill_ms = k_uptime_get();
+
+#ifdef CONFIG_USB_DEVICE_STACK_NEXT
+	k_work_init(&can_err_in_work, can_err_in_handler);
+#endif
+	k_work_init_delayable(&can_err_poll_work, can_err_poll_handler);
+	k_work_reschedule(&can_err_poll_work, K_MSEC(CAN_ERR_REPORT_POLL_MS));
+
+	LOG_INF("CAN error reporting: %u frames/s, burst %u", CAN_ERR_REPORT_RATE,
+		CAN_ERR_REPORT_BURST);
+}
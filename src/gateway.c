@@ -0,0 +1,477 @@
+/*
+ * CAN gateway (host to bus and bus to bus ID remapping) for roboto_usb2can
+ */
+
+#include "roboto_usb2can.h"
+
+LOG_MODULE_REGISTER(gateway, LOG_LEVEL_INF);
+
+/* Route table entry */
+struct gw_route_entry {
+	struct gw_route cfg;
+	struct gw_route_stats stats;
+	uint64_t latency_sum_ns;
+	bool valid;
+};
+
+/* Owner of an RX filter whose frames pass through gw_dispatch() */
+struct gw_tap {
+	can_rx_callback_t callback;
+	void *user_data;
+};
+
+/* Traffic a route applies to */
+enum gw_path {
+	GW_PATH_BUS,  /* Received from the bus, retransmitted */
+	GW_PATH_HOST, /* Sent by the host */
+	GW_PATH_COUNT,
+};
+
+static struct gw_route_entry gw_routes[GW_MAX_ROUTES];
+static bool gw_enabled;
+
+/* Route index + 1 per standard ID and path, one nibble per path (0: no route) */
+static uint8_t gw_std_lut[CAN_STD_ID_MASK + 1];
+/* Extended ID routes per path in priority order */
+static uint8_t gw_ext_routes[GW_PATH_COUNT][GW_MAX_ROUTES];
+static uint8_t gw_ext_count[GW_PATH_COUNT];
+
+static struct gw_tap gw_taps[GW_MAX_TAPS];
+/* Standalone mode catch-all filters (standard, extended), -1 if not installed */
+static struct gw_tap gw_own_tap;
+static int gw_own_filters[2];
+
+int __real_can_add_rx_filter(const struct device *dev, can_rx_callback_t callback,
+			     void *user_data, const struct can_filter *filter);
+int __real_z_impl_can_send(const struct device *dev, const struct can_frame *frame,
+			   k_timeout_t timeout, can_tx_callback_t callback, void *user_data);
+
+/* Transmission of a remapped frame completed */
+static void gw_tx_callback(const struct device *dev, int error, void *user_data)
+{
+	struct gw_route_entry *route = user_data;
+
+	ARG_UNUSED(dev);
+
+	if (error != 0) {
+		route->stats.tx_errors++;
+	}
+}
+
+/* First route matching a frame on a path: direct-indexed for standard IDs */
+static struct gw_route_entry *gw_lookup(const struct can_frame *frame, enum gw_path path)
+{
+	if ((frame->flags & CAN_FRAME_IDE) == 0) {
+		uint8_t entry = (gw_std_lut[frame->id] >> (path * 4U)) & 0x0F;
+
+		return entry != 0 ? &gw_routes[entry - 1] : NULL;
+	}
+
+	for (uint8_t i = 0; i < gw_ext_count[path]; i++) {
+		struct gw_route_entry *route = &gw_routes[gw_ext_routes[path][i]];
+
+		if (((frame->id ^ route->cfg.match_id) & route->cfg.match_mask) == 0) {
+			return route;
+		}
+	}
+
+	return NULL;
+}
+
+/* Apply a route's ID remap and data rewrite to a copy of the frame */
+static void gw_rewrite(const struct gw_route *cfg, const struct can_frame *frame,
+		       struct can_frame *out)
+{
+	uint8_t len;
+
+	*out = *frame;
+	if (cfg->flags & GW_ROUTE_FLAG_REMAP) {
+		out->id = cfg->new_id & ((out->flags & CAN_FRAME_IDE) ? CAN_EXT_ID_MASK
+								      : CAN_STD_ID_MASK);
+	}
+
+	len = MIN(can_dlc_to_bytes(out->dlc), sizeof(cfg->data_mask));
+	for (uint8_t i = 0; i < len; i++) {
+		out->data[i] = (out->data[i] & ~cfg->data_mask[i]) |
+			       (cfg->data_value[i] & cfg->data_mask[i]);
+	}
+}
+
+/* Count a frame queued by a route, start is the cycle count at the match */
+static void gw_account(struct gw_route_entry *route, uint32_t start)
+{
+	uint64_t latency_ns;
+
+	route->stats.forwarded++;
+
+	latency_ns = k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+	route->latency_sum_ns += latency_ns;
+	route->stats.latency_max_ns = MAX(route->stats.latency_max_ns, (uint32_t)latency_ns);
+}
+
+/* Drop or remap and retransmit a received frame, returns true if it was queued */
+static bool gw_route_frame(const struct device *dev, const struct can_frame *frame,
+			   struct gw_route_entry *route, uint32_t start)
+{
+	struct can_frame out;
+
+	route->stats.hits++;
+
+	if (route->cfg.flags & GW_ROUTE_FLAG_DROP) {
+		route->stats.dropped++;
+		return false;
+	}
+
+	gw_rewrite(&route->cfg, frame, &out);
+
+	if (__real_z_impl_can_send(dev, &out, K_NO_WAIT, gw_tx_callback, route) != 0) {
+		route->stats.tx_errors++;
+		return false;
+	}
+
+	gw_account(route, start);
+	return true;
+}
+
+/*
+ * Single RX callback behind every controller filter: the route lookup runs
+ * on the frame first, then the filter's owner (gs_usb) gets it unchanged,
+ * so routes mirror traffic without taking frames away from the host.
+ */
+static void gw_dispatch(const struct device *dev, struct can_frame *frame, void *user_data)
+{
+	const struct gw_tap *tap = user_data;
+	struct gw_route_entry *route;
+	uint32_t start;
+
+	if (gw_enabled) {
+		HOT_PATH_START();
+
+		start = k_cycle_get_32();
+		route = gw_lookup(frame, GW_PATH_BUS);
+		if (route != NULL && gw_route_frame(dev, frame, route, start)) {
+			HOT_PATH_END(HOT_PATH_GATEWAY);
+		}
+	}
+
+	if (tap->callback != NULL) {
+		tap->callback(dev, frame, tap->user_data);
+	}
+}
+
+/* Tap for a filter owner, reused for the same callback and user data */
+static struct gw_tap *gw_tap_get(can_rx_callback_t callback, void *user_data)
+{
+	struct gw_tap *free_tap = NULL;
+
+	for (int i = 0; i < ARRAY_SIZE(gw_taps); i++) {
+		struct gw_tap *tap = &gw_taps[i];
+
+		if (tap->callback == callback && tap->user_data == user_data) {
+			return tap;
+		}
+		if (tap->callback == NULL && free_tap == NULL) {
+			free_tap = tap;
+		}
+	}
+
+	if (free_tap != NULL) {
+		free_tap->user_data = user_data;
+		free_tap->callback = callback;
+	}
+
+	return free_tap;
+}
+
+/* Remove the standalone mode catch-all filters */
+static void gw_release_own_filters(const struct device *dev)
+{
+	for (int i = 0; i < ARRAY_SIZE(gw_own_filters); i++) {
+		if (gw_own_filters[i] >= 0) {
+			can_remove_rx_filter(dev, gw_own_filters[i]);
+			gw_own_filters[i] = -1;
+		}
+	}
+}
+
+/*
+ * All RX filters are added through here (linked with
+ * --wrap=can_add_rx_filter). The filter itself is installed unchanged, only
+ * its callback is routed through gw_dispatch(), so the filter ID returned to
+ * the owner stays valid for can_remove_rx_filter().
+ */
+int __wrap_can_add_rx_filter(const struct device *dev, can_rx_callback_t callback,
+			     void *user_data, const struct can_filter *filter)
+{
+	struct gw_tap *tap = gw_tap_get(callback, user_data);
+
+	if (tap == NULL) {
+		LOG_WRN("No free gateway tap, filter bypasses the routes");
+		return __real_can_add_rx_filter(dev, callback, user_data, filter);
+	}
+
+	/* A host driving the channel takes over from the standalone filters */
+	gw_release_own_filters(dev);
+
+	return __real_can_add_rx_filter(dev, gw_dispatch, tap, filter);
+}
+
+/*
+ * All frames are sent through here (linked with --wrap=z_impl_can_send), so
+ * frames from the host pass the routes before they reach the bus. A dropped
+ * frame completes with success so the host still gets its echo; the echo
+ * carries the frame as the host sent it, not as rewritten.
+ */
+int __wrap_z_impl_can_send(const struct device *dev, const struct can_frame *frame,
+			   k_timeout_t timeout, can_tx_callback_t callback, void *user_data)
+{
+	struct gw_route_entry *route;
+	struct can_frame out;
+	uint32_t start;
+	int err;
+
+	if (!gw_enabled) {
+		return __real_z_impl_can_send(dev, frame, timeout, callback, user_data);
+	}
+
+	HOT_PATH_START();
+
+	start = k_cycle_get_32();
+	route = gw_lookup(frame, GW_PATH_HOST);
+	if (route == NULL) {
+		return __real_z_impl_can_send(dev, frame, timeout, callback, user_data);
+	}
+
+	route->stats.hits++;
+
+	if (route->cfg.flags & GW_ROUTE_FLAG_DROP) {
+		route->stats.dropped++;
+		if (callback != NULL) {
+			callback(dev, 0, user_data);
+		}
+		return 0;
+	}
+
+	gw_rewrite(&route->cfg, frame, &out);
+
+	err = __real_z_impl_can_send(dev, &out, timeout, callback, user_data);
+	if (err != 0) {
+		route->stats.tx_errors++;
+		return err;
+	}
+
+	gw_account(route, start);
+	HOT_PATH_END(HOT_PATH_GATEWAY);
+	return 0;
+}
+
+/* Catch-all filters feeding the routes while no host has started the channel */
+static int gw_install_own_filters(const struct device *dev)
+{
+	const struct can_filter filters[] = {
+		{.id = 0, .mask = 0, .flags = 0},
+		{.id = 0, .mask = 0, .flags = CAN_FILTER_IDE},
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(filters); i++) {
+		if (gw_own_filters[i] >= 0) {
+			continue;
+		}
+
+		gw_own_filters[i] = __real_can_add_rx_filter(dev, gw_dispatch, &gw_own_tap,
+							     &filters[i]);
+		if (gw_own_filters[i] < 0) {
+			int err = gw_own_filters[i];
+
+			gw_own_filters[i] = -1;
+			gw_release_own_filters(dev);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/* Whether a route applies to a path, routes without a path flag apply to both */
+static bool gw_route_on_path(const struct gw_route *cfg, enum gw_path path)
+{
+	uint8_t paths = cfg->flags & (GW_ROUTE_FLAG_BUS | GW_ROUTE_FLAG_HOST);
+
+	return paths == 0 || (paths & (path == GW_PATH_BUS ? GW_ROUTE_FLAG_BUS
+							  : GW_ROUTE_FLAG_HOST)) != 0;
+}
+
+/* Build the lookup tables from the valid routes, lower index wins on overlap */
+static void gw_build_tables(void)
+{
+	memset(gw_std_lut, 0, sizeof(gw_std_lut));
+
+	for (int path = 0; path < GW_PATH_COUNT; path++) {
+		uint8_t shift = path * 4U;
+
+		gw_ext_count[path] = 0;
+
+		for (int i = ARRAY_SIZE(gw_routes) - 1; i >= 0; i--) {
+			const struct gw_route *cfg = &gw_routes[i].cfg;
+
+			if (!gw_routes[i].valid || (cfg->flags & GW_ROUTE_FLAG_IDE) ||
+			    !gw_route_on_path(cfg, path)) {
+				continue;
+			}
+
+			for (uint32_t id = 0; id <= CAN_STD_ID_MASK; id++) {
+				if (((id ^ cfg->match_id) & cfg->match_mask & CAN_STD_ID_MASK) != 0) {
+					continue;
+				}
+
+				gw_std_lut[id] = (gw_std_lut[id] & ~(0x0F << shift)) |
+						 ((i + 1) << shift);
+			}
+		}
+
+		for (int i = 0; i < ARRAY_SIZE(gw_routes); i++) {
+			const struct gw_route *cfg = &gw_routes[i].cfg;
+
+			if (gw_routes[i].valid && (cfg->flags & GW_ROUTE_FLAG_IDE) &&
+			    gw_route_on_path(cfg, path)) {
+				gw_ext_routes[path][gw_ext_count[path]++] = i;
+			}
+		}
+	}
+}
+
+/* Set or clear (empty payload) a route */
+static int gw_set_route(uint16_t index, const struct net_buf *buf)
+{
+	struct gw_route_entry *route;
+
+	if (gw_enabled) {
+		/* Routes are only changed while the lookup tables are not in use */
+		return -EBUSY;
+	}
+
+	if (index >= ARRAY_SIZE(gw_routes)) {
+		return -EINVAL;
+	}
+
+	route = &gw_routes[index];
+
+	if (buf->len == 0) {
+		route->valid = false;
+		return 0;
+	}
+
+	if (buf->len != sizeof(route->cfg)) {
+		return -EINVAL;
+	}
+
+	memcpy(&route->cfg, buf->data, sizeof(route->cfg));
+	route->cfg.match_id = sys_le32_to_cpu(route->cfg.match_id);
+	route->cfg.match_mask = sys_le32_to_cpu(route->cfg.match_mask);
+	route->cfg.new_id = sys_le32_to_cpu(route->cfg.new_id);
+	memset(&route->stats, 0, sizeof(route->stats));
+	route->latency_sum_ns = 0;
+	route->valid = true;
+
+	LOG_INF("Route %u: 0x%08x/0x%08x flags 0x%02x -> 0x%08x", index, route->cfg.match_id,
+		route->cfg.match_mask, route->cfg.flags, route->cfg.new_id);
+	return 0;
+}
+
+/* Enable or disable the gateway, optionally starting the controller standalone */
+static int gw_enable(bool enable, const struct net_buf *buf)
+{
+	const struct device *dev = can_devices[0];
+	uint32_t bitrate = 0;
+	int err;
+
+	if (buf->len >= sizeof(bitrate)) {
+		bitrate = sys_get_le32(buf->data);
+	}
+
+	if (!enable) {
+		gw_enabled = false;
+		gw_release_own_filters(dev);
+		return 0;
+	}
+
+	if (gw_enabled) {
+		return 0;
+	}
+
+	gw_build_tables();
+
+	/* Standalone mode: run the bus without a host driving the channel */
+	if (bitrate != 0) {
+		err = gw_install_own_filters(dev);
+		if (err != 0) {
+			LOG_ERR("No free RX filter for standalone gateway (err %d)", err);
+			return err;
+		}
+
+		can_stop(dev);
+		err = can_set_bitrate(dev, bitrate);
+		if (err == 0) {
+			err = can_start(dev);
+		}
+		if (err != 0) {
+			LOG_ERR("Failed to start CAN for standalone gateway (err %d)", err);
+			gw_release_own_filters(dev);
+			return err;
+		}
+	}
+
+	gw_enabled = true;
+	LOG_INF("Gateway enabled%s", bitrate ? " (standalone)" : "");
+	return 0;
+}
+
+/* Handle gateway vendor requests (host to device) */
+int gw_vendor_request(const struct usb_setup_packet *setup, const struct net_buf *buf)
+{
+	switch (setup->wIndex) {
+	case ROBOTO_VREQ_GW_ROUTE:
+		return gw_set_route(setup->wValue, buf);
+
+	case ROBOTO_VREQ_GW_ENABLE:
+		return gw_enable(setup->wValue != 0, buf);
+
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/* Copy per-route counters into a vendor request response */
+int gw_stats_drain(struct net_buf *buf)
+{
+	for (int i = 0; i < ARRAY_SIZE(gw_routes); i++) {
+		struct gw_route_entry *route = &gw_routes[i];
+		struct gw_route_stats stats = route->stats;
+
+		if (net_buf_tailroom(buf) < sizeof(stats)) {
+			break;
+		}
+
+		if (stats.forwarded != 0) {
+			stats.latency_avg_ns = route->latency_sum_ns / stats.forwarded;
+		}
+
+		stats.hits = sys_cpu_to_le32(stats.hits);
+		stats.forwarded = sys_cpu_to_le32(stats.forwarded);
+		stats.dropped = sys_cpu_to_le32(stats.dropped);
+		stats.tx_errors = sys_cpu_to_le32(stats.tx_errors);
+		stats.latency_avg_ns = sys_cpu_to_le32(stats.latency_avg_ns);
+		stats.latency_max_ns = sys_cpu_to_le32(stats.latency_max_ns);
+		net_buf_add_mem(buf, &stats, sizeof(stats));
+	}
+
+	return 0;
+}
+
+/* Initialize the gateway route table */
+void gw_init(void)
+{
+	for (int i = 0; i < ARRAY_SIZE(gw_own_filters); i++) {
+		gw_own_filters[i] = -1;
+	}
+}
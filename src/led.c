@@ -28,6 +28,7 @@ bool can_led_state = false;
 struct k_timer activity_tick_timer;
 k_timepoint_t last_activity_time;
 int activity_ticks = 0;
+bool activity_led_ready = false;
 k_timepoint_t last_stopped_time;
 
 /* USB LED blink work (Blue LED) */
@@ -98,6 +99,7 @@ static void activity_led_off_work(struct k_work *work)
 	gpio_pin_set_dt(&activity_led, 0);
 }
 
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
 /* Activity LED timer callback (triggers every 50ms) */
 static void activity_tick_handler(struct k_timer *timer)
 {
@@ -114,6 +116,7 @@ static void activity_tick_handler(struct k_timer *timer)
 		}
 	}
 }
+#endif /* CONFIG_ROBOTO_ACTIVITY_LED */
 
 /* Initialize status LED */
 int status_led_init(void)
@@ -141,6 +144,7 @@ int status_led_init(void)
 			LOG_WRN("Failed to configure activity LED: %d", ret);
 		} else {
 			k_work_init_delayable(&activity_work, activity_led_off_work);
+			activity_led_ready = IS_ENABLED(CONFIG_ROBOTO_ACTIVITY_LED);
 			LOG_INF("Activity LED initialized");
 		}
 	}
@@ -161,10 +165,12 @@ int status_led_init(void)
 	/* Initialize work queues */
 	k_work_init_delayable(&usb_led_work, usb_led_blink_work);
 
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
 	/* Initialize activity LED timer */
 	k_timer_init(&activity_tick_timer, activity_tick_handler, NULL);
 	k_timer_start(&activity_tick_timer, K_MSEC(LED_TICK_MS), K_MSEC(LED_TICK_MS));
 	last_activity_time = sys_timepoint_calc(K_NO_WAIT);
+#endif
 	last_stopped_time = sys_timepoint_calc(K_NO_WAIT); /* Initialize STOPPED filter */
 
 	/* Start with USB ready state */
@@ -221,10 +227,12 @@ void status_led_can_set(enum can_led_status status)
 	LOG_DBG("CAN LED status changed to %d", status);
 }
 
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
 /* CAN activity indication (independently controls green LED, does not affect blue LED) */
 void status_led_can_activity(void)
 {
-	if (!gpio_is_ready_dt(&activity_led)) {
+	/* GPIO readiness is resolved once at init, not per frame */
+	if (!activity_led_ready) {
 		return;
 	}
 
@@ -243,14 +251,17 @@ int status_led_event(const struct device *dev, uint16_t ch, enum gs_usb_event ev
 	switch (event) {
 	case GS_USB_EVENT_CHANNEL_ACTIVITY_RX:
 		__fallthrough;
-	case GS_USB_EVENT_CHANNEL_ACTIVITY_TX:
+	case GS_USB_EVENT_CHANNEL_ACTIVITY_TX: {
+		HOT_PATH_START();
 		/* Low-pass filter: prevent LED from blinking too fast */
-		if (!sys_timepoint_expired(last_activity_time)) {
-			return 0; /* Ignore frequent events */
+		if (sys_timepoint_expired(last_activity_time)) {
+			last_activity_time =
+				sys_timepoint_calc(K_MSEC(LED_TICK_MS * LED_TICKS_ACTIVITY));
+			status_led_can_activity();
 		}
-		last_activity_time = sys_timepoint_calc(K_MSEC(LED_TICK_MS * LED_TICKS_ACTIVITY));
-		status_led_can_activity();
+		HOT_PATH_END(HOT_PATH_LED_EVENT);
 		break;
+	}
 
 	case GS_USB_EVENT_CHANNEL_STARTED:
 		LOG_DBG("Channel %u started", ch);
@@ -282,3 +293,4 @@ int status_led_event(const struct device *dev, uint16_t ch, enum gs_usb_event ev
 
 	return 0;
 }
+#endif /* CONFIG_ROBOTO_ACTIVITY_LED */
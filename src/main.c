@@ -15,10 +15,11 @@ USBD_CONFIGURATION_DEFINE(fs_config, 0, 250, &fs_config_desc);
 #endif
 
 /**
- * @brief Microsoft OS 2.0 descriptor vendor request handler
+ * @brief Vendor request handler (device to host)
  *
  * Handles Windows-specific vendor requests for MSOS 2.0 descriptors,
  * enabling automatic WinUSB driver binding without manual driver installation.
+ * Other wIndex values select roboto_usb2can specific requests (ROBOTO_VREQ_*).
  *
  * @param ctx USB device context
  * @param setup USB setup packet containing the request
@@ -29,25 +30,117 @@ static int msos_vendor_handler(const struct usbd_context *const ctx,
 			       const struct usb_setup_packet *const setup,
 			       struct net_buf *const buf)
 {
-	if (setup->bRequest == 0x01 && setup->wIndex == MS_OS_20_DESCRIPTOR_INDEX) {
+	if (setup->bRequest != ROBOTO_VENDOR_CODE) {
+		return -ENOTSUP;
+	}
+
+	switch (setup->wIndex) {
+	case MS_OS_20_DESCRIPTOR_INDEX: {
 		size_t len = sizeof(msos2_desc);
 		net_buf_add_mem(buf, &msos2_desc, MIN(net_buf_tailroom(buf), len));
 		LOG_INF("Windows requested MSOS2 descriptor");
 		return 0;
 	}
+
+#ifdef CONFIG_ROBOTO_GATEWAY
+	case ROBOTO_VREQ_GW_STATS:
+		return gw_stats_drain(buf);
+#endif
+
+#ifdef CONFIG_ROBOTO_HOT_PATH_STATS
+	case ROBOTO_VREQ_PROFILE:
+		return hot_path_report_drain(buf);
+#endif
+
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/**
+ * @brief Vendor request handler (host to device)
+ *
+ * Handles roboto_usb2can specific configuration requests (ROBOTO_VREQ_*).
+ *
+ * @param ctx USB device context
+ * @param setup USB setup packet containing the request
+ * @param buf Network buffer with the request data
+ * @return 0 on success, -ENOTSUP for unsupported requests
+ */
+static int vendor_from_host_handler(const struct usbd_context *const ctx,
+				    const struct usb_setup_packet *const setup,
+				    const struct net_buf *const buf)
+{
+	if (setup->bRequest != ROBOTO_VENDOR_CODE) {
+		return -ENOTSUP;
+	}
+
+#ifdef CONFIG_ROBOTO_GATEWAY
+	return gw_vendor_request(setup, buf);
+#else
 	return -ENOTSUP;
+#endif
 }
 
+/* 64-bit extension of the 32-bit cycle counter behind the gs_usb timestamps */
+static struct k_spinlock timestamp_lock;
+static uint64_t timestamp_cycles;
+static uint32_t timestamp_last;
+
+uint32_t roboto_timestamp_us(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&timestamp_lock);
+	uint32_t now = k_cycle_get_32();
+	uint64_t cycles;
+
+	timestamp_cycles += now - timestamp_last;
+	timestamp_last = now;
+	cycles = timestamp_cycles;
+
+	k_spin_unlock(&timestamp_lock, key);
+
+	return (uint32_t)k_cyc_to_us_floor64(cycles);
+}
+
+/* The cycle counter wraps every few seconds at full clock, sample it more often */
+static void timestamp_timer_handler(struct k_timer *timer)
+{
+	ARG_UNUSED(timer);
+	(void)roboto_timestamp_us();
+}
+
+K_TIMER_DEFINE(timestamp_timer, timestamp_timer_handler, NULL);
+
+#ifdef CONFIG_USBD_GS_USB_TIMESTAMP
+/**
+ * @brief gs_usb hardware timestamp callback
+ *
+ * Supplies the microsecond timestamp reported with every host frame.
+ *
+ * @param dev Pointer to the gs_usb device
+ * @param timestamp Timestamp output (microseconds, wraps at 32 bits)
+ * @param user_data User data pointer
+ * @return 0 on success
+ */
+static int gs_usb_timestamp(const struct device *dev, uint32_t *timestamp, void *user_data)
+{
+	*timestamp = roboto_timestamp_us();
+
+	return 0;
+}
+#endif
+
 /* Register BOS Descriptors */
 USBD_DESC_BOS_DEFINE(bos_lpm, sizeof(bos_cap_lpm), &bos_cap_lpm);
-USBD_DESC_BOS_VREQ_DEFINE(bos_msosv2, sizeof(bos_cap_msosv2), &bos_cap_msosv2, 0x01,
-			  msos_vendor_handler, NULL);
+USBD_DESC_BOS_VREQ_DEFINE(bos_msosv2, sizeof(bos_cap_msosv2), &bos_cap_msosv2,
+			  ROBOTO_VENDOR_CODE, msos_vendor_handler, vendor_from_host_handler);
 
 /**
  * @brief CAN state change callback - Error monitoring and protection
  *
  * This callback monitors CAN bus state changes and implements error protection
  * mechanisms including error frame flood detection and automatic bus-off recovery.
+ * Every state change is also reported to the host as an error frame.
  *
  * @param dev Pointer to the CAN device
  * @param state Current CAN bus state
@@ -62,6 +155,8 @@ static void can_state_change_callback(const struct device *dev, enum can_state s
 	struct can_error_monitor *mon = &err_monitors[ch];
 	int64_t now = k_uptime_get();
 
+	can_err_report_state(ch, state, err_cnt);
+
 	/* Reset statistics window */
 	if ((now - mon->window_start_ms) > CAN_ERR_WINDOW_MS) {
 		mon->err_frame_count = 0;
@@ -152,7 +247,8 @@ static void can_state_change_callback(const struct device *dev, enum can_state s
  *
  * Initializes the roboto_usb2can adapter including:
  * - Status LED system
- * - CAN error monitoring
+ * - CAN error monitoring and error frame reporting
+ * - CAN gateway route table
  * - GS-USB protocol stack
  * - USB device configuration (WinUSB support)
  *
@@ -163,7 +259,13 @@ int main(void)
 	const struct device *gs_usb = DEVICE_DT_GET(DT_NODELABEL(gs_usb0));
 	const struct device *channels[] = {DEVICE_DT_GET(DT_NODELABEL(fdcan1))};
 	struct gs_usb_ops ops = {
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
+		/* Called for every frame, not registered without the activity LED */
 		.event = status_led_event,
+#endif
+#ifdef CONFIG_USBD_GS_USB_TIMESTAMP
+		.timestamp = gs_usb_timestamp,
+#endif
 	};
 	int err;
 
@@ -173,7 +275,8 @@ int main(void)
 		LOG_ERR("Failed to initialize status LED (err %d)", err);
 	}
 
-	printk("*** roboto_usb2can adapter v%s ***\n", APP_VERSION_STR);
+	printk("*** roboto_usb2can adapter v%s (%s) ***\n", APP_VERSION_STR,
+	       CONFIG_ROBOTO_PROFILE_NAME);
 
 	/* Initialize CAN error monitoring */
 	for (int i = 0; i < ARRAY_SIZE(can_devices); i++) {
@@ -191,6 +294,17 @@ int main(void)
 		err_monitors[i].window_start_ms = k_uptime_get();
 	}
 
+	/* Keep the timestamp cycle count extended */
+	k_timer_start(&timestamp_timer, K_SECONDS(1), K_SECONDS(1));
+
+	/* Initialize error frame reporting to the host */
+	can_err_report_init();
+
+#ifdef CONFIG_ROBOTO_GATEWAY
+	/* Initialize gateway route table (configured via vendor requests) */
+	gw_init();
+#endif
+
 	if (!device_is_ready(gs_usb)) {
 		LOG_ERR("gs_usb not ready");
 		return -1;
@@ -279,6 +393,12 @@ int main(void)
 		return err;
 	}
 
+	/* Error frames share the gs_usb bulk IN endpoint with the RX frames */
+	err = can_err_report_attach("gs_usb_0");
+	if (err != 0) {
+		LOG_ERR("failed to attach error frame reporting (err %d)", err);
+	}
+
 	err = usbd_enable(&usbd);
 	if (err != 0) {
 		LOG_ERR("failed to enable USB device (err %d)", err);
@@ -0,0 +1,65 @@
+/*
+ * Hot-path cycle counters for roboto_usb2can build profiles
+ */
+
+#include "roboto_usb2can.h"
+
+/* Cycle counters per hook */
+struct hot_path_counter {
+	uint32_t frames;
+	uint64_t cycles;
+	uint32_t max_cycles;
+};
+
+static struct hot_path_counter hot_path_counters[HOT_PATH_COUNT];
+
+/* Account one frame (may be called from interrupt context) */
+void hot_path_account(enum hot_path path, uint32_t cycles)
+{
+	struct hot_path_counter *counter = &hot_path_counters[path];
+	unsigned int key = irq_lock();
+
+	counter->frames++;
+	counter->cycles += cycles;
+	counter->max_cycles = MAX(counter->max_cycles, cycles);
+
+	irq_unlock(key);
+}
+
+/* Copy the build profile and counters into a vendor request response */
+int hot_path_report_drain(struct net_buf *buf)
+{
+	struct hot_path_report_header header = {
+		.profile_id = CONFIG_ROBOTO_PROFILE_ID,
+		.path_count = HOT_PATH_COUNT,
+		.cycles_per_sec = sys_cpu_to_le32(sys_clock_hw_cycles_per_sec()),
+	};
+
+	if (net_buf_tailroom(buf) < sizeof(header)) {
+		return 0;
+	}
+
+	net_buf_add_mem(buf, &header, sizeof(header));
+
+	for (int i = 0; i < HOT_PATH_COUNT; i++) {
+		struct hot_path_counter counter;
+		struct hot_path_report_entry entry;
+		unsigned int key;
+
+		if (net_buf_tailroom(buf) < sizeof(entry)) {
+			break;
+		}
+
+		key = irq_lock();
+		counter = hot_path_counters[i];
+		irq_unlock(key);
+
+		entry.frames = sys_cpu_to_le32(counter.frames);
+		entry.avg_cycles =
+			sys_cpu_to_le32(counter.frames ? counter.cycles / counter.frames : 0);
+		entry.max_cycles = sys_cpu_to_le32(counter.max_cycles);
+		net_buf_add_mem(buf, &entry, sizeof(entry));
+	}
+
+	return 0;
+}
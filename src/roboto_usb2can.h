@@ -28,6 +28,13 @@
 		'c', 0x00, '-', 0x00, '9', 0x00, '3', 0x00, '2', 0x00, '5', 0x00, '5', 0x00, '5',  \
 		0x00, 'd', 0x00, '6', 0x00, '8', 0x00, 'e', 0x00, '6', 0x00, '}', 0x00, 0x00, 0x00
 
+/* Vendor requests on bMS_VendorCode (device recipient), selected by wIndex */
+#define ROBOTO_VENDOR_CODE     0x01
+#define ROBOTO_VREQ_GW_ROUTE   0x0020 /* OUT: set route wValue (empty payload clears it) */
+#define ROBOTO_VREQ_GW_ENABLE  0x0021 /* OUT: wValue 1/0, optional u32 bitrate (standalone) */
+#define ROBOTO_VREQ_GW_STATS   0x0022 /* IN: per-route counters */
+#define ROBOTO_VREQ_PROFILE    0x0030 /* IN: build profile and hot-path cycle counters */
+
 /* MSOS 2.0 Descriptor Structure */
 struct msos2_descriptor {
 	struct msosv2_descriptor_set_header header;
@@ -107,7 +114,7 @@ static const struct usb_bos_msosv2 bos_cap_msosv2 = {
 		{
 			.dwWindowsVersion = sys_cpu_to_le32(0x06030000),
 			.wMSOSDescriptorSetTotalLength = sys_cpu_to_le16(sizeof(msos2_desc)),
-			.bMS_VendorCode = 0x01, /* Vendor Request Code */
+			.bMS_VendorCode = ROBOTO_VENDOR_CODE, /* Vendor Request Code */
 			.bAltEnumCode = 0x00,
 		},
 };
@@ -126,6 +133,120 @@ struct can_error_monitor {
 	bool forced_busoff;         /* Whether Bus-Off forced */
 };
 
+/* CAN error frame reporting to the host */
+#define CAN_ERR_REPORT_RATE      20 /* Sustained error frames per second */
+#define CAN_ERR_REPORT_BURST     8  /* Token bucket depth (error frames) */
+#define CAN_ERR_REPORT_QUEUE_LEN 16 /* Error frames waiting for the host */
+#define CAN_ERR_REPORT_POLL_MS   50 /* Protocol error counter poll interval */
+#define CAN_ERR_REPORT_IN_FLIGHT 2  /* Error frames queued on the bulk IN endpoint */
+
+/* SocketCAN error frame encoding (linux/can/error.h) */
+#define SOCKETCAN_ERR_FLAG     0x20000000U
+#define SOCKETCAN_ERR_DLC      8
+#define SOCKETCAN_ERR_CRTL     0x00000004U /* Controller problems, data[1] */
+#define SOCKETCAN_ERR_PROT     0x00000008U /* Protocol violations, data[2..3] */
+#define SOCKETCAN_ERR_ACK      0x00000020U /* Received no ACK on transmission */
+#define SOCKETCAN_ERR_BUSOFF   0x00000040U /* Bus off */
+#define SOCKETCAN_ERR_BUSERROR 0x00000080U /* Bus error */
+#define SOCKETCAN_ERR_CNT      0x00000200U /* TEC in data[6], REC in data[7] */
+
+#define SOCKETCAN_ERR_CRTL_UNSPEC      0x00
+#define SOCKETCAN_ERR_CRTL_RX_OVERFLOW 0x01
+#define SOCKETCAN_ERR_CRTL_RX_WARNING  0x04
+#define SOCKETCAN_ERR_CRTL_TX_WARNING  0x08
+#define SOCKETCAN_ERR_CRTL_RX_PASSIVE  0x10
+#define SOCKETCAN_ERR_CRTL_TX_PASSIVE  0x20
+#define SOCKETCAN_ERR_CRTL_ACTIVE      0x40
+
+#define SOCKETCAN_ERR_PROT_FORM        0x02
+#define SOCKETCAN_ERR_PROT_STUFF       0x04
+#define SOCKETCAN_ERR_PROT_BIT0        0x08
+#define SOCKETCAN_ERR_PROT_BIT1        0x10
+#define SOCKETCAN_ERR_PROT_LOC_CRC_SEQ 0x08
+
+/* Summary frame: reserved byte marks it, data[2..5] holds the suppressed count (LE) */
+#define CAN_ERR_SUMMARY_MARKER       0xE5
+#define CAN_ERR_SUMMARY_COUNT_OFFSET 2
+
+/* gs_usb host frame carrying a classic CAN error frame */
+struct can_err_host_frame {
+	uint32_t echo_id;
+	uint32_t can_id;
+	uint8_t can_dlc;
+	uint8_t channel;
+	uint8_t flags;
+	uint8_t reserved;
+	uint8_t data[SOCKETCAN_ERR_DLC];
+} __packed;
+
+/* Error frame transfer size, gs_usb appends the timestamp to every host frame */
+#ifdef CONFIG_USBD_GS_USB_TIMESTAMP
+#define CAN_ERR_IN_FRAME_SIZE (sizeof(struct can_err_host_frame) + sizeof(uint32_t))
+#else
+#define CAN_ERR_IN_FRAME_SIZE sizeof(struct can_err_host_frame)
+#endif
+
+/* CAN gateway configuration */
+#define GW_MAX_ROUTES 8 /* Matched in software, first valid route wins */
+#define GW_MAX_TAPS   4 /* RX filter owners (callback/user data) seen by the routes */
+
+#define GW_ROUTE_FLAG_IDE   BIT(0) /* Match extended IDs */
+#define GW_ROUTE_FLAG_REMAP BIT(1) /* Replace the ID with new_id */
+#define GW_ROUTE_FLAG_DROP  BIT(2) /* Drop matching frames instead of forwarding */
+#define GW_ROUTE_FLAG_BUS   BIT(3) /* Apply to frames received from the bus */
+#define GW_ROUTE_FLAG_HOST  BIT(4) /* Apply to frames sent by the host */
+/* Routes with neither GW_ROUTE_FLAG_BUS nor GW_ROUTE_FLAG_HOST apply to both */
+
+/* Gateway route (vendor request payload, little endian) */
+struct gw_route {
+	uint32_t match_id;     /* ID to match */
+	uint32_t match_mask;   /* Relevant ID bits */
+	uint32_t new_id;       /* Replacement ID (GW_ROUTE_FLAG_REMAP) */
+	uint8_t flags;         /* GW_ROUTE_FLAG_* */
+	uint8_t reserved[3];
+	uint8_t data_mask[8];  /* Data bits to overwrite */
+	uint8_t data_value[8]; /* Values for the overwritten bits */
+} __packed;
+
+/* Gateway per-route counters (vendor request response, little endian) */
+struct gw_route_stats {
+	uint32_t hits;           /* Frames matched */
+	uint32_t forwarded;      /* Frames queued for transmission */
+	uint32_t dropped;        /* Frames dropped by the route */
+	uint32_t tx_errors;      /* Frames that failed to queue or send */
+	uint32_t latency_avg_ns; /* Average match to queued latency */
+	uint32_t latency_max_ns; /* Maximum match to queued latency */
+} __packed;
+
+/* Per-frame application hooks measured by the hot-path counters */
+enum hot_path {
+	HOT_PATH_LED_EVENT, /* gs_usb RX/TX activity event */
+	HOT_PATH_GATEWAY,   /* Gateway route match to queued */
+	HOT_PATH_COUNT,
+};
+
+/* Hot-path report (vendor request response, little endian) */
+struct hot_path_report_header {
+	uint8_t profile_id;      /* CONFIG_ROBOTO_PROFILE_ID */
+	uint8_t path_count;      /* Number of hot_path_report_entry that follow */
+	uint16_t reserved;
+	uint32_t cycles_per_sec; /* CPU cycle counter frequency */
+} __packed;
+
+struct hot_path_report_entry {
+	uint32_t frames;     /* Frames through the hook */
+	uint32_t avg_cycles; /* Average cycles per frame */
+	uint32_t max_cycles; /* Maximum cycles per frame */
+} __packed;
+
+#ifdef CONFIG_ROBOTO_HOT_PATH_STATS
+#define HOT_PATH_START()    uint32_t hot_path_start = k_cycle_get_32()
+#define HOT_PATH_END(path)  hot_path_account(path, k_cycle_get_32() - hot_path_start)
+#else
+#define HOT_PATH_START()    do { } while (0)
+#define HOT_PATH_END(path)  do { } while (0)
+#endif
+
 static struct can_error_monitor err_monitors[1]
 	__attribute__((unused)) = {0}; /* Single channel, extensible */
 static const struct device *can_devices[]
@@ -205,14 +326,22 @@ void status_led_can_set(enum can_led_status status);
  *
  * Briefly flashes the green LED to show CAN data transmission or reception activity.
  * This function is typically called from interrupt context.
+ * Compiled to nothing without CONFIG_ROBOTO_ACTIVITY_LED.
  */
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
 void status_led_can_activity(void);
+#else
+static inline void status_led_can_activity(void)
+{
+}
+#endif
 
 /**
  * @brief GS-USB event callback for LED status updates
  *
  * Callback function registered with the GS-USB stack to receive bus events
- * and update LED status accordingly.
+ * and update LED status accordingly. gs_usb calls it for every frame, so it
+ * is only built and registered with CONFIG_ROBOTO_ACTIVITY_LED.
  *
  * @param dev Pointer to the device
  * @param ch Channel number
@@ -220,7 +349,92 @@ void status_led_can_activity(void);
  * @param user_data User data pointer
  * @return 0 on success, negative error code on failure
  */
+#ifdef CONFIG_ROBOTO_ACTIVITY_LED
 int status_led_event(const struct device *dev, uint16_t ch, enum gs_usb_event event,
 		     void *user_data);
+#endif
+
+/**
+ * @brief Current gs_usb timestamp
+ *
+ * Microseconds since boot from the cycle counter, wrapping at 32 bits like
+ * the gs_usb host frame timestamp. May be called from interrupt context.
+ *
+ * @return Timestamp in microseconds
+ */
+uint32_t roboto_timestamp_us(void);
+
+/**
+ * @brief Initialize CAN error frame reporting
+ *
+ * Starts the periodic poll of the CAN protocol error counters.
+ */
+void can_err_report_init(void);
+
+/**
+ * @brief Report a CAN state change to the host
+ *
+ * Encodes the state and TEC/REC as a SocketCAN error frame and queues it,
+ * subject to the token bucket rate limit. The protocol errors behind the
+ * change follow from the next counter poll, which is triggered at once.
+ * May be called from interrupt context.
+ *
+ * @param ch Channel number
+ * @param state New CAN bus state
+ * @param err_cnt CAN error counters (TX/RX)
+ */
+void can_err_report_state(uint8_t ch, enum can_state state, struct can_bus_err_cnt err_cnt);
+
+/**
+ * @brief Send error frames on the bulk IN endpoint of a gs_usb class instance
+ *
+ * Error frames reach the host like received frames, so the Linux gs_usb
+ * driver passes them to SocketCAN. Must be called after usbd_init(), once
+ * the endpoint addresses are assigned.
+ *
+ * @param class_name Name of the registered gs_usb class instance
+ * @return 0 on success, -ENODEV if the class is not found, -ENOENT without bulk IN
+ */
+int can_err_report_attach(const char *class_name);
+
+/**
+ * @brief Initialize the CAN gateway route table
+ */
+void gw_init(void);
+
+/**
+ * @brief Handle a gateway vendor request (host to device)
+ *
+ * Routes can only be changed while the gateway is disabled.
+ *
+ * @param setup USB setup packet containing the request
+ * @param buf Network buffer with the request data
+ * @return 0 on success, -EBUSY if enabled, -ENOTSUP for unknown requests
+ */
+int gw_vendor_request(const struct usb_setup_packet *setup, const struct net_buf *buf);
+
+/**
+ * @brief Copy the per-route gateway counters into a vendor request response
+ *
+ * @param buf Network buffer for response data
+ * @return 0 on success
+ */
+int gw_stats_drain(struct net_buf *buf);
+
+/**
+ * @brief Account the cycles one frame spent in a hot-path hook
+ *
+ * @param path Hook that processed the frame
+ * @param cycles CPU cycles spent
+ */
+void hot_path_account(enum hot_path path, uint32_t cycles);
+
+/**
+ * @brief Copy the build profile and hot-path counters into a vendor request response
+ *
+ * @param buf Network buffer for response data
+ * @return 0 on success
+ */
+int hot_path_report_drain(struct net_buf *buf);
 
 #endif /* ROBOTO_USB2CAN_H_ */